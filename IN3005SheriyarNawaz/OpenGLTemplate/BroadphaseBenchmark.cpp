@@ -0,0 +1,114 @@
+/*
+ Collision broadphase benchmark.  Places 1,000, 10,000 and 100,000 collectibles along a circular track, one every 15
+ units with the track length scaled to match, then times the per-frame collision query of CRaceSimulation::CheckCollision
+ (CTrackBroadphase::Query and CCollectibleSet::FindWithin on the candidates) at random car positions, against testing
+ every object.  Both must find the same objects.
+
+ Not part of the Windows build (it has its own main).  On Linux, from this directory:
+
+   g++ -O2 -std=c++17 -I. BroadphaseBenchmark.cpp CollectibleSet.cpp TrackBroadphase.cpp -o broadphase_benchmark
+
+ Usage: broadphase_benchmark [queries]
+*/
+
+#include "CollectibleSet.h"
+#include "TrackBroadphase.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+static const float SPACING = 15.0f;			// Track distance between neighbouring objects
+static const float COLLISION_RADIUS = 15.0f;	// As CRaceSimulation::CheckCollision
+static const float BUCKET_LENGTH = 25.0f;		// As CTrackPlacements::LoadCollectibles
+static const float HALF_WIDTH = 20.0f;		// Objects and the car are placed up to this far either side of the centreline
+
+static float Random(float lo, float hi)
+{
+	return lo + (hi - lo) * rand() / (float)RAND_MAX;
+}
+
+// The point at distance d along a circle of circumference trackLength, moved sideways by offset
+static glm::vec3 TrackPoint(float d, float offset, float trackLength)
+{
+	float radius = trackLength / (2.0f * (float)M_PI);
+	float angle = d / radius;
+	return (radius + offset) * glm::vec3(cos(angle), 0.0f, sin(angle));
+}
+
+int main(int argc, char** argv)
+{
+	int numQueries = 100000;
+	if (argc > 1)
+		numQueries = glm::max(1, atoi(argv[1]));
+
+	const int sizes[] = { 1000, 10000, 100000 };
+
+	printf("%-10s %14s %14s %10s\n", "objects", "broadphase", "brute force", "hits");
+	bool identical = true;
+	for (int s = 0; s < 3; s++) {
+		int n = sizes[s];
+		float trackLength = n * SPACING;
+		srand(1);
+
+		CCollectibleSet set;
+		vector<float> distances(n);
+		set.Reserve(n);
+		for (int i = 0; i < n; i++) {
+			distances[i] = i * SPACING;
+			set.Add(TrackPoint(distances[i], Random(-HALF_WIDTH, HALF_WIDTH), trackLength));
+		}
+
+		CTrackBroadphase broadphase;
+		broadphase.Build(distances, trackLength, BUCKET_LENGTH);
+
+		vector<float> carDistances(numQueries);
+		vector<glm::vec3> carPositions(numQueries);
+		for (int q = 0; q < numQueries; q++) {
+			carDistances[q] = Random(0.0f, trackLength);
+			carPositions[q] = TrackPoint(carDistances[q], Random(-HALF_WIDTH, HALF_WIDTH), trackLength);
+		}
+
+		// As CheckCollision: candidates from twice the collision radius, then the exact test on those only
+		vector<int> candidates, hits;
+		long long broadphaseHits = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int q = 0; q < numQueries; q++) {
+			candidates.clear();
+			hits.clear();
+			broadphase.Query(carDistances[q], 2.0f * COLLISION_RADIUS, candidates);
+			set.FindWithin(carPositions[q], COLLISION_RADIUS, candidates, hits);
+			broadphaseHits += hits.size();
+		}
+		double broadphaseTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Testing every object is O(n) a query, so fewer queries are timed at the larger sizes
+		int bruteQueries = glm::min(numQueries, glm::max(100, 100000000 / n));
+		vector<int> bruteHits;
+		start = std::chrono::steady_clock::now();
+		for (int q = 0; q < bruteQueries; q++) {
+			bruteHits.clear();
+			set.FindWithin(carPositions[q], COLLISION_RADIUS, 0, n, bruteHits);
+		}
+		double bruteTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// Same objects found, untimed
+		for (int q = 0; q < bruteQueries; q++) {
+			candidates.clear();
+			hits.clear();
+			bruteHits.clear();
+			broadphase.Query(carDistances[q], 2.0f * COLLISION_RADIUS, candidates);
+			set.FindWithin(carPositions[q], COLLISION_RADIUS, candidates, hits);
+			set.FindWithin(carPositions[q], COLLISION_RADIUS, 0, n, bruteHits);
+			std::sort(hits.begin(), hits.end());
+			if (hits != bruteHits)
+				identical = false;
+		}
+
+		printf("%-10d %11.1f ns %11.2f us %10.2f\n", n, broadphaseTime / numQueries * 1.0e9, bruteTime / bruteQueries * 1.0e6,
+			broadphaseHits / (double)numQueries);
+	}
+
+	printf(identical ? "The broadphase found the same objects as brute force\n" : "The broadphase missed objects\n");
+	return identical ? 0 : 1;
+}
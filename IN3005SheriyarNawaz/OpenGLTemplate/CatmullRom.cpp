@@ -1,12 +1,23 @@
 #include "CatmullRom.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <algorithm>
+#include <float.h>
 
+// SampleMany uses AVX2 (8 lanes, hardware gathers) when the compiler targets it, otherwise SSE2 (4 lanes), which every x64 CPU has
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CATMULLROM_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CATMULLROM_SSE2
+#endif
 
 
 CCatmullRom::CCatmullRom()
 {
-    m_vertexCount = 0;
+    m_bucketLength = 0.0f;
+    m_segmentSearch = SEGMENT_SEARCH_BUCKETS;
 }
 
 CCatmullRom::~CCatmullRom()
@@ -28,6 +39,18 @@ glm::vec3 CCatmullRom::Interpolate(glm::vec3& p0, glm::vec3& p1, glm::vec3& p2,
 
 }
 
+// Derivative with respect to t of the Catmull Rom spline between p1 and p2 (see Interpolate)
+glm::vec3 CCatmullRom::InterpolateDerivative(glm::vec3& p0, glm::vec3& p1, glm::vec3& p2, glm::vec3& p3, float t)
+{
+    float t2 = t * t;
+
+    glm::vec3 b = 0.5f * (-p0 + p2);
+    glm::vec3 c = 0.5f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3);
+    glm::vec3 d = 0.5f * (-p0 + 3.0f * p1 - 3.0f * p2 + p3);
+
+    return b + 2.0f * c * t + 3.0f * d * t2;
+}
+
 // Determine lengths along the control points, which is the set of control points forming the closed curve
 void CCatmullRom::ComputeLengthsAlongControlPoints()
 {
@@ -45,40 +68,184 @@ void CCatmullRom::ComputeLengthsAlongControlPoints()
     m_distances.push_back(fAccumulatedLength);
 }
 
+// Build a uniform bucket index over the arc-length table so that a segment can be found in constant time.  Each bucket stores the
+// first segment that overlaps it.  Buckets are made no longer than the shortest segment, so each overlaps at most two segments
+// and a lookup steps forward at most once.  A very short segment would need too many buckets, so there are at most
+// MAX_BUCKETS_PER_SEGMENT per segment; then the buckets near short segments may each cover several of them.
+void CCatmullRom::BuildArcLengthTable()
+{
+    const int MAX_BUCKETS_PER_SEGMENT = 4;
+
+    m_segmentBuckets.clear();
+    m_bucketLength = 0.0f;
+
+    int numSegments = (int)m_distances.size() - 1;
+    if (numSegments <= 0 || m_distances.back() <= 0.0f)
+        return;
+
+    float fShortest = m_distances.back();
+    for (int j = 0; j < numSegments; j++)
+        fShortest = std::min(fShortest, m_distances[j + 1] - m_distances[j]);
+
+    int maxBuckets = MAX_BUCKETS_PER_SEGMENT * numSegments;
+    int numBuckets = maxBuckets;
+    if (fShortest > 0.0f && m_distances.back() / fShortest < maxBuckets)
+        numBuckets = std::max((int)ceil(m_distances.back() / fShortest), 1);
+
+    m_bucketLength = m_distances.back() / numBuckets;
+    m_segmentBuckets.resize(numBuckets);
+
+    int j = 0;
+    for (int b = 0; b < numBuckets; b++) {
+        float fBucketStart = b * m_bucketLength;
+        while (j < numSegments - 1 && m_distances[j + 1] <= fBucketStart)
+            j++;
+        m_segmentBuckets[b] = j;
+    }
+}
+
+// Expand the Catmull-Rom basis of every segment into cubic coefficients (see Interpolate).  Each segment j interpolates between
+// control points j and j + 1 of the closed curve.
+void CCatmullRom::BuildSegmentCoefficients()
+{
+    int M = (int)m_controlPoints.size();
+    bool hasUpVectors = m_controlUpVectors.size() == m_controlPoints.size();
+
+    for (int c = 0; c < 3; c++) {
+        for (int k = 0; k < 4; k++) {
+            m_positionCoeffs[c][k].resize(M);
+            m_upCoeffs[c][k].resize(hasUpVectors ? M : 0);
+        }
+    }
+
+    for (int j = 0; j < M; j++) {
+        int iPrev = ((j - 1) + M) % M;
+        int iNext = (j + 1) % M;
+        int iNextNext = (j + 2) % M;
+
+        for (int c = 0; c < 3; c++) {
+            float p0 = m_controlPoints[iPrev][c], p1 = m_controlPoints[j][c], p2 = m_controlPoints[iNext][c], p3 = m_controlPoints[iNextNext][c];
+            m_positionCoeffs[c][0][j] = p1;
+            m_positionCoeffs[c][1][j] = 0.5f * (-p0 + p2);
+            m_positionCoeffs[c][2][j] = 0.5f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3);
+            m_positionCoeffs[c][3][j] = 0.5f * (-p0 + 3.0f * p1 - 3.0f * p2 + p3);
+
+            if (hasUpVectors) {
+                float u0 = m_controlUpVectors[iPrev][c], u1 = m_controlUpVectors[j][c], u2 = m_controlUpVectors[iNext][c], u3 = m_controlUpVectors[iNextNext][c];
+                m_upCoeffs[c][0][j] = u1;
+                m_upCoeffs[c][1][j] = 0.5f * (-u0 + u2);
+                m_upCoeffs[c][2][j] = 0.5f * (2.0f * u0 - 5.0f * u1 + 4.0f * u2 - u3);
+                m_upCoeffs[c][3][j] = 0.5f * (-u0 + 3.0f * u1 - 3.0f * u2 + u3);
+            }
+        }
+    }
+}
+
+// Find the segment containing fLength, which must already be wrapped into [0, total length]
+int CCatmullRom::FindSegment(float fLength)
+{
+    int numSegments = (int)m_distances.size() - 1;
+
+    if (m_segmentSearch == SEGMENT_SEARCH_LINEAR) {
+        int j = 0;
+        while (j < numSegments - 1 && m_distances[j + 1] <= fLength)
+            j++;
+        return j;
+    }
+
+    if (m_segmentSearch == SEGMENT_SEARCH_BUCKETS && !m_segmentBuckets.empty()) {
+        // Constant time: jump to the bucket, then step forward to the exact segment
+        int b = (int)(fLength / m_bucketLength);
+        b = std::min(std::max(b, 0), (int)m_segmentBuckets.size() - 1);
+        int j = m_segmentBuckets[b];
+        while (j < numSegments - 1 && m_distances[j + 1] <= fLength)
+            j++;
+        return j;
+    }
+
+    // Logarithmic time: binary search the arc-length table
+    int j = (int)(std::upper_bound(m_distances.begin(), m_distances.end(), fLength) - m_distances.begin()) - 1;
+    return std::min(std::max(j, 0), numSegments - 1);
+}
+
+// Find the segment containing fLength by stepping forwards or backwards from the cursor's last segment.  If the query has jumped
+// further than a few segments (e.g. the first query, or wrapping around at the end of a lap) fall back to the indexed lookup.
+int CCatmullRom::FindSegment(float fLength, SplineCursor& cursor)
+{
+    const int maxSteps = 4;
+    int numSegments = (int)m_distances.size() - 1;
+
+    int j = cursor.segment;
+    if (j >= 0 && j < numSegments) {
+        int steps = 0;
+        while (steps < maxSteps && j < numSegments - 1 && m_distances[j + 1] <= fLength) {
+            j++;
+            steps++;
+        }
+        while (steps < maxSteps && j > 0 && m_distances[j] > fLength) {
+            j--;
+            steps++;
+        }
+        if (steps == maxSteps)
+            j = FindSegment(fLength);
+    }
+    else {
+        j = FindSegment(fLength);
+    }
+
+    cursor.segment = j;
+    return j;
+}
+
 
 // Return the point (and upvector, if control upvectors provided) based on a distance d along the control polygon
 bool CCatmullRom::Sample(float d, glm::vec3& p, glm::vec3& up)
+{
+    SplineCursor cursor;
+    return Sample(d, cursor, p, up);
+}
+
+// The length along the control polygon for distance d; handle the case where we've looped around the track.  Distances
+// before the start are out of range.  Sample and SampleMany both go through here, so they agree on which distances fail
+bool CCatmullRom::WrapDistance(float d, float& fLength)
 {
     if (d < 0)
         return false;
 
-    int M = (int)m_controlPoints.size();
-    if (M == 0)
+    fLength = fmodf(d, m_distances.back());
+    return true;
+}
+
+// Find the segment containing distance d (wrapping around the track), and the parameter t along it
+bool CCatmullRom::Locate(float d, SplineCursor& cursor, int& segment, float& t)
+{
+    if (m_controlPoints.size() == 0)
         return false;
 
+    float fLength;
+    if (!WrapDistance(d, fLength))
+        return false;
 
-    float fTotalLength = m_distances[m_distances.size() - 1];
+    // Find the current segment
+    segment = FindSegment(fLength, cursor);
 
-    // The the current length along the control polygon; handle the case where we've looped around the track
-    float fLength = d - (int)(d / fTotalLength) * fTotalLength;
+    // Interpolate on current segment -- get t
+    float fSegmentLength = m_distances[segment + 1] - m_distances[segment];
+    t = (fLength - m_distances[segment]) / fSegmentLength;
 
-    // Find the current segment
-    int j = -1;
-    for (int i = 0; i < (int)m_distances.size() - 1; i++) {
-        if (fLength >= m_distances[i] && fLength < m_distances[i + 1]) {
-            j = i; // found it!
-            break;
-        }
-    }
+    return true;
+}
 
-    if (j == -1)
+// As above, but the segment search starts from the cursor, which is updated to the segment containing d
+bool CCatmullRom::Sample(float d, SplineCursor& cursor, glm::vec3& p, glm::vec3& up)
+{
+    int j;
+    float t;
+    if (!Locate(d, cursor, j, t))
         return false;
 
-    // Interpolate on current segment -- get t
-    float fSegmentLength = m_distances[j + 1] - m_distances[j];
-    float t = (fLength - m_distances[j]) / fSegmentLength;
-
     // Get the indices of the four points along the control polygon for the current segment
+    int M = (int)m_controlPoints.size();
     int iPrev = ((j - 1) + M) % M;
     int iCur = j;
     int iNext = (j + 1) % M;
@@ -92,43 +259,269 @@ bool CCatmullRom::Sample(float d, glm::vec3& p, glm::vec3& up)
     return true;
 }
 
+// Return the point at distance d with its tangent, normal and binormal
+bool CCatmullRom::SampleFrame(float d, SplineFrame& frame)
+{
+    SplineCursor cursor;
+    return SampleFrame(d, cursor, frame);
+}
+
+// As above, but the segment search starts from the cursor.  The tangent comes from the derivative of the spline, so one evaluation
+// gives the whole frame.
+bool CCatmullRom::SampleFrame(float d, SplineCursor& cursor, SplineFrame& frame)
+{
+    int j;
+    float t;
+    if (!Locate(d, cursor, j, t))
+        return false;
+
+    int M = (int)m_controlPoints.size();
+    int iPrev = ((j - 1) + M) % M;
+    int iCur = j;
+    int iNext = (j + 1) % M;
+    int iNextNext = (j + 2) % M;
+
+    glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    frame.p = Interpolate(m_controlPoints[iPrev], m_controlPoints[iCur], m_controlPoints[iNext], m_controlPoints[iNextNext], t);
+    frame.T = glm::normalize(InterpolateDerivative(m_controlPoints[iPrev], m_controlPoints[iCur], m_controlPoints[iNext], m_controlPoints[iNextNext], t));
+    frame.N = glm::normalize(glm::cross(frame.T, worldUp));
+    frame.B = glm::normalize(glm::cross(frame.N, frame.T));
+    if (m_controlUpVectors.size() == m_controlPoints.size())
+        frame.up = glm::normalize(Interpolate(m_controlUpVectors[iPrev], m_controlUpVectors[iCur], m_controlUpVectors[iNext], m_controlUpVectors[iNextNext], t));
+    else
+        frame.up = worldUp;
+
+    return true;
+}
+
+// Evaluate many distances along the centreline.  Segment lookup is scalar (and amortised O(1) for sorted distances thanks to the
+// cursor); the cubic evaluation runs in EvaluateSegments, several distances per SIMD register.
+bool CCatmullRom::SampleMany(const float* distances, size_t n, glm::vec3* outPos, glm::vec3* outUp, glm::vec3* outTangent)
+{
+    if (m_controlPoints.empty() || m_positionCoeffs[0][0].size() != m_controlPoints.size())
+        return false;
+
+    // A distance Sample would reject fails the whole call, before any output is written
+    for (size_t i = 0; i < n; i++) {
+        if (distances[i] < 0)
+            return false;
+    }
+
+    const size_t batchSize = 256;
+    int segments[batchSize];
+    float ts[batchSize];
+
+    SplineCursor cursor;
+
+    for (size_t first = 0; first < n; first += batchSize) {
+        size_t count = std::min(batchSize, n - first);
+
+        for (size_t i = 0; i < count; i++) {
+            float fLength;
+            WrapDistance(distances[first + i], fLength);
+
+            int j = FindSegment(fLength, cursor);
+            segments[i] = j;
+            ts[i] = (fLength - m_distances[j]) / (m_distances[j + 1] - m_distances[j]);
+        }
+
+        EvaluateSegments(segments, ts, count,
+            outPos ? outPos + first : NULL,
+            outUp && !m_upCoeffs[0][0].empty() ? outUp + first : NULL,
+            outTangent ? outTangent + first : NULL);
+    }
+
+    return true;
+}
+
+// Scalar evaluation of the segment cubics, used for whatever does not fill a SIMD register (or for everything, without SSE2)
+void CCatmullRom::EvaluateSegmentsScalar(const int* segments, const float* ts, size_t n, glm::vec3* outPos, glm::vec3* outUp, glm::vec3* outTangent)
+{
+    for (size_t i = 0; i < n; i++) {
+        int j = segments[i];
+        float t = ts[i];
+        glm::vec3 p, dp, u;
+        for (int c = 0; c < 3; c++) {
+            p[c] = ((m_positionCoeffs[c][3][j] * t + m_positionCoeffs[c][2][j]) * t + m_positionCoeffs[c][1][j]) * t + m_positionCoeffs[c][0][j];
+            dp[c] = (3.0f * m_positionCoeffs[c][3][j] * t + 2.0f * m_positionCoeffs[c][2][j]) * t + m_positionCoeffs[c][1][j];
+            if (outUp)
+                u[c] = ((m_upCoeffs[c][3][j] * t + m_upCoeffs[c][2][j]) * t + m_upCoeffs[c][1][j]) * t + m_upCoeffs[c][0][j];
+        }
+        if (outPos) outPos[i] = p;
+        if (outTangent) outTangent[i] = glm::normalize(dp);
+        if (outUp) outUp[i] = glm::normalize(u);
+    }
+}
+
+#if defined(CATMULLROM_AVX2)
+
+// Eight lanes at a time, loading each segment's coefficients with a gather
+void CCatmullRom::EvaluateSegments(const int* segments, const float* ts, size_t n, glm::vec3* outPos, glm::vec3* outUp, glm::vec3* outTangent)
+{
+    const size_t lanes = 8;
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(segments + i));
+        __m256 t = _mm256_loadu_ps(ts + i);
+        __m256 two = _mm256_set1_ps(2.0f), three = _mm256_set1_ps(3.0f);
+
+        float pos[3][lanes], tan[3][lanes], up[3][lanes];
+        __m256 tanLength2 = _mm256_setzero_ps(), upLength2 = _mm256_setzero_ps();
+        __m256 tanC[3], upC[3];
+
+        for (int c = 0; c < 3; c++) {
+            __m256 a = _mm256_i32gather_ps(&m_positionCoeffs[c][0][0], idx, 4);
+            __m256 b = _mm256_i32gather_ps(&m_positionCoeffs[c][1][0], idx, 4);
+            __m256 cc = _mm256_i32gather_ps(&m_positionCoeffs[c][2][0], idx, 4);
+            __m256 d = _mm256_i32gather_ps(&m_positionCoeffs[c][3][0], idx, 4);
+
+            // p = ((d t + c) t + b) t + a,  dp/dt = (3 d t + 2 c) t + b
+            __m256 p = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(d, t), cc), t), b), t), a);
+            _mm256_storeu_ps(pos[c], p);
+
+            tanC[c] = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(three, d), t), _mm256_mul_ps(two, cc)), t), b);
+            tanLength2 = _mm256_add_ps(tanLength2, _mm256_mul_ps(tanC[c], tanC[c]));
+
+            if (outUp) {
+                a = _mm256_i32gather_ps(&m_upCoeffs[c][0][0], idx, 4);
+                b = _mm256_i32gather_ps(&m_upCoeffs[c][1][0], idx, 4);
+                cc = _mm256_i32gather_ps(&m_upCoeffs[c][2][0], idx, 4);
+                d = _mm256_i32gather_ps(&m_upCoeffs[c][3][0], idx, 4);
+                upC[c] = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(d, t), cc), t), b), t), a);
+                upLength2 = _mm256_add_ps(upLength2, _mm256_mul_ps(upC[c], upC[c]));
+            }
+        }
+
+        __m256 tanScale = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_max_ps(tanLength2, _mm256_set1_ps(1e-24f))));
+        __m256 upScale = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(_mm256_max_ps(upLength2, _mm256_set1_ps(1e-24f))));
+        for (int c = 0; c < 3; c++) {
+            _mm256_storeu_ps(tan[c], _mm256_mul_ps(tanC[c], tanScale));
+            if (outUp)
+                _mm256_storeu_ps(up[c], _mm256_mul_ps(upC[c], upScale));
+        }
+
+        for (size_t k = 0; k < lanes; k++) {
+            if (outPos) outPos[i + k] = glm::vec3(pos[0][k], pos[1][k], pos[2][k]);
+            if (outTangent) outTangent[i + k] = glm::vec3(tan[0][k], tan[1][k], tan[2][k]);
+            if (outUp) outUp[i + k] = glm::vec3(up[0][k], up[1][k], up[2][k]);
+        }
+    }
+
+    // Remaining distances
+    EvaluateSegmentsScalar(segments + i, ts + i, n - i,
+        outPos ? outPos + i : NULL, outUp ? outUp + i : NULL, outTangent ? outTangent + i : NULL);
+}
+
+#elif defined(CATMULLROM_SSE2)
+
+// Four lanes at a time; SSE2 has no gather, so the coefficients of each lane's segment are loaded individually
+static inline __m128 GatherCoeffs(const vector<float>& coeffs, const int* segments)
+{
+    return _mm_set_ps(coeffs[segments[3]], coeffs[segments[2]], coeffs[segments[1]], coeffs[segments[0]]);
+}
+
+void CCatmullRom::EvaluateSegments(const int* segments, const float* ts, size_t n, glm::vec3* outPos, glm::vec3* outUp, glm::vec3* outTangent)
+{
+    const size_t lanes = 4;
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        const int* idx = segments + i;
+        __m128 t = _mm_loadu_ps(ts + i);
+        __m128 two = _mm_set1_ps(2.0f), three = _mm_set1_ps(3.0f);
+
+        float pos[3][lanes], tan[3][lanes], up[3][lanes];
+        __m128 tanLength2 = _mm_setzero_ps(), upLength2 = _mm_setzero_ps();
+        __m128 tanC[3], upC[3];
+
+        for (int c = 0; c < 3; c++) {
+            __m128 a = GatherCoeffs(m_positionCoeffs[c][0], idx);
+            __m128 b = GatherCoeffs(m_positionCoeffs[c][1], idx);
+            __m128 cc = GatherCoeffs(m_positionCoeffs[c][2], idx);
+            __m128 d = GatherCoeffs(m_positionCoeffs[c][3], idx);
+
+            // p = ((d t + c) t + b) t + a,  dp/dt = (3 d t + 2 c) t + b
+            __m128 p = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(d, t), cc), t), b), t), a);
+            _mm_storeu_ps(pos[c], p);
+
+            tanC[c] = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(three, d), t), _mm_mul_ps(two, cc)), t), b);
+            tanLength2 = _mm_add_ps(tanLength2, _mm_mul_ps(tanC[c], tanC[c]));
+
+            if (outUp) {
+                a = GatherCoeffs(m_upCoeffs[c][0], idx);
+                b = GatherCoeffs(m_upCoeffs[c][1], idx);
+                cc = GatherCoeffs(m_upCoeffs[c][2], idx);
+                d = GatherCoeffs(m_upCoeffs[c][3], idx);
+                upC[c] = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(d, t), cc), t), b), t), a);
+                upLength2 = _mm_add_ps(upLength2, _mm_mul_ps(upC[c], upC[c]));
+            }
+        }
+
+        __m128 tanScale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(tanLength2, _mm_set1_ps(1e-24f))));
+        __m128 upScale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(upLength2, _mm_set1_ps(1e-24f))));
+        for (int c = 0; c < 3; c++) {
+            _mm_storeu_ps(tan[c], _mm_mul_ps(tanC[c], tanScale));
+            if (outUp)
+                _mm_storeu_ps(up[c], _mm_mul_ps(upC[c], upScale));
+        }
+
+        for (size_t k = 0; k < lanes; k++) {
+            if (outPos) outPos[i + k] = glm::vec3(pos[0][k], pos[1][k], pos[2][k]);
+            if (outTangent) outTangent[i + k] = glm::vec3(tan[0][k], tan[1][k], tan[2][k]);
+            if (outUp) outUp[i + k] = glm::vec3(up[0][k], up[1][k], up[2][k]);
+        }
+    }
+
+    // Remaining distances
+    EvaluateSegmentsScalar(segments + i, ts + i, n - i,
+        outPos ? outPos + i : NULL, outUp ? outUp + i : NULL, outTangent ? outTangent + i : NULL);
+}
+
+#else
+
+void CCatmullRom::EvaluateSegments(const int* segments, const float* ts, size_t n, glm::vec3* outPos, glm::vec3* outUp, glm::vec3* outTangent)
+{
+    EvaluateSegmentsScalar(segments, ts, n, outPos, outUp, outTangent);
+}
+
+#endif
+
 // Sample a set of control points using an open Catmull-Rom spline, to produce a set of iNumSamples that are (roughly) equally spaced
 void CCatmullRom::UniformlySampleControlPoints(int numSamples)
 {
-    glm::vec3 p, up;
+    vector<float> distances(numSamples);
 
     // Compute the lengths of each segment along the control polygon, and the total length
     ComputeLengthsAlongControlPoints();
+    BuildArcLengthTable();
+    BuildSegmentCoefficients();
     float fTotalLength = m_distances[m_distances.size() - 1];
 
     // The spacing will be based on the control polygon
     float fSpacing = fTotalLength / numSamples;
 
-    // Call PointAt to sample the spline, to generate the points
-    for (int i = 0; i < numSamples; i++) {
-        Sample(i * fSpacing, p, up);
-        m_centrelinePoints.push_back(p);
-        if (m_controlUpVectors.size() > 0)
-            m_centrelineUpVectors.push_back(up);
-
-    }
+    // Sample the spline in one batch, to generate the points
+    for (int i = 0; i < numSamples; i++)
+        distances[i] = i * fSpacing;
+    m_centrelinePoints.resize(numSamples);
+    if (m_controlUpVectors.size() > 0)
+        m_centrelineUpVectors.resize(numSamples);
+    SampleMany(&distances[0], numSamples, &m_centrelinePoints[0], m_centrelineUpVectors.empty() ? NULL : &m_centrelineUpVectors[0]);
 
 
     // Repeat once more for truly equidistant points
     m_controlPoints = m_centrelinePoints;
     m_controlUpVectors = m_centrelineUpVectors;
-    m_centrelinePoints.clear();
-    m_centrelineUpVectors.clear();
     m_distances.clear();
     ComputeLengthsAlongControlPoints();
+    BuildArcLengthTable();
+    BuildSegmentCoefficients();
     fTotalLength = m_distances[m_distances.size() - 1];
     fSpacing = fTotalLength / numSamples;
-    for (int i = 0; i < numSamples; i++) {
-        Sample(i * fSpacing, p, up);
-        m_centrelinePoints.push_back(p);
-        if (m_controlUpVectors.size() > 0)
-            m_centrelineUpVectors.push_back(up);
-    }
+    for (int i = 0; i < numSamples; i++)
+        distances[i] = i * fSpacing;
+    m_centrelineTangents.resize(numSamples);
+    SampleMany(&distances[0], numSamples, &m_centrelinePoints[0], m_centrelineUpVectors.empty() ? NULL : &m_centrelineUpVectors[0], &m_centrelineTangents[0]);
 }
 
 void CCatmullRom::SetControlPoints()
@@ -163,42 +556,19 @@ void CCatmullRom::SetControlPoints()
     m_controlPoints.push_back(glm::vec3(180, 1, 20));
 }
 
-void CCatmullRom::CreateCentreline()
+void CCatmullRom::CreateCentreline(int numSamples)
 {
     // Call Set Control Points
     SetControlPoints();
 
     // Call UniformlySampleControlPoints with the number of samples required
-    UniformlySampleControlPoints(500);
-
-    // Create a VAO called m_vaoCentreline and a VBO to get the points onto the graphics card
-    glGenVertexArrays(1, &m_vaoCentreline);
-    glBindVertexArray(m_vaoCentreline);
-    CVertexBufferObject vbo;
-    vbo.Create();
-    vbo.Bind();
-
-    //Default texture coordinates and normals for all points
-    glm::vec2 texCoord(0.0f, 0.0f);
-    glm::vec3 normal(0.0f, 1.0f, 0.0f);
-
-    //Add all centreline points to VBO
-    for (unsigned int i = 0; i < m_centrelinePoints.size(); i++) {
-        glm::vec3 v = m_centrelinePoints[i];
-        vbo.AddData(&v, sizeof(glm::vec3));
-        vbo.AddData(&texCoord, sizeof(glm::vec2));
-        vbo.AddData(&normal, sizeof(glm::vec3));
-    }
+    m_distances.clear();
+    UniformlySampleControlPoints(numSamples);
+}
 
-    vbo.UploadDataToGPU(GL_STATIC_DRAW);
-    GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
-        (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+void CCatmullRom::SetSegmentSearch(SegmentSearch search)
+{
+    m_segmentSearch = search;
 }
 
 void CCatmullRom::CreateOffsetCurves()
@@ -210,11 +580,8 @@ void CCatmullRom::CreateOffsetCurves()
 
     //Calculate offset points for each cenrelinePoint
     for (unsigned int i = 0; i < m_centrelinePoints.size(); i++) {
-        //Current and next point
         glm::vec3 p = m_centrelinePoints[i];
-        glm::vec3 pNext = m_centrelinePoints[(i + 1) % m_centrelinePoints.size()];
-
-        glm::vec3 T = glm::normalize(pNext - p); //Tangent vector in direction to travel
+        glm::vec3 T = m_centrelineTangents[i]; //Tangent vector in direction to travel, from the spline derivative
         glm::vec3 N = glm::normalize(glm::vec3(-T.z, 0.0f, T.x)); // Normal vector
 
         //Calculate left and right offset points
@@ -224,171 +591,34 @@ void CCatmullRom::CreateOffsetCurves()
         m_leftOffsetPoints.push_back(l);
         m_rightOffsetPoints.push_back(r);
     }
-
-    glGenVertexArrays(1, &m_vaoLeftOffsetCurve);
-    glBindVertexArray(m_vaoLeftOffsetCurve);
-    CVertexBufferObject vboLeft;
-    vboLeft.Create();
-    vboLeft.Bind();
-
-    glm::vec2 texCoord(0.0f, 0.0f);
-    glm::vec3 normal(0.0f, 1.0f, 0.0f);
-
-
-    //Add all left points to VBO
-    for (unsigned int i = 0; i < m_leftOffsetPoints.size(); i++) {
-        glm::vec3 v = m_leftOffsetPoints[i];
-        vboLeft.AddData(&v, sizeof(glm::vec3));
-        vboLeft.AddData(&texCoord, sizeof(glm::vec2));
-        vboLeft.AddData(&normal, sizeof(glm::vec3));
-    }
-
-    vboLeft.UploadDataToGPU(GL_STATIC_DRAW);
-    GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
-        (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
-
-    glGenVertexArrays(1, &m_vaoRightOffsetCurve);
-    glBindVertexArray(m_vaoRightOffsetCurve);
-    CVertexBufferObject vboRight;
-    vboRight.Create();
-    vboRight.Bind();
-
-    //Add all right points to vbo
-    for (unsigned int i = 0; i < m_rightOffsetPoints.size(); i++) {
-        glm::vec3 v = m_rightOffsetPoints[i];
-        vboRight.AddData(&v, sizeof(glm::vec3));
-        vboRight.AddData(&texCoord, sizeof(glm::vec2));
-        vboRight.AddData(&normal, sizeof(glm::vec3));
-    }
-
-    vboRight.UploadDataToGPU(GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
-        (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
 }
 
-void CCatmullRom::CreateTrack(string directory, string filename)
+int CCatmullRom::CurrentLap(float d)
 {
-    //Load track texture
-    m_texture.Load(directory + filename, true);
-    m_texture.SetSamplerObjectParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    m_texture.SetSamplerObjectParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
-    m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glGenVertexArrays(1, &m_vaoTrack);
-    glBindVertexArray(m_vaoTrack);
-
-    CVertexBufferObject vboTrack;
-    vboTrack.Create();
-    vboTrack.Bind();
-
-    //Default normals pointing up
-    glm::vec3 normal(0.0f, 1.0f, 0.0f);
-
-    unsigned int numPoints = m_leftOffsetPoints.size();
-
-    //Create triangles that connect left and right sides of the track
-    for (unsigned int i = 0; i < numPoints; i++) {
-        float texCoordS = (float)i / 10.0f; //Texture coordinates, texture repeats every 10 points
-
-        unsigned int nextIndex = (i + 1) % numPoints;
-
-        //Add left vertex
-        glm::vec3 leftPoint = m_leftOffsetPoints[i];
-        glm::vec2 leftTexCoord(0.0f, texCoordS);
-        vboTrack.AddData(&leftPoint, sizeof(glm::vec3));
-        vboTrack.AddData(&leftTexCoord, sizeof(glm::vec2));
-        vboTrack.AddData(&normal, sizeof(glm::vec3));
-
-        // Add right vertex
-        glm::vec3 rightPoint = m_rightOffsetPoints[i];
-        glm::vec2 rightTexCoord(1.0f, texCoordS);
-        vboTrack.AddData(&rightPoint, sizeof(glm::vec3));
-        vboTrack.AddData(&rightTexCoord, sizeof(glm::vec2));
-        vboTrack.AddData(&normal, sizeof(glm::vec3));
-    }
-
-    //Extra pair of vertices at end to close loop
-    glm::vec3 leftPoint = m_leftOffsetPoints[0];
-    glm::vec2 leftTexCoord(0.0f, (float)numPoints / 10.0f);
-    vboTrack.AddData(&leftPoint, sizeof(glm::vec3));
-    vboTrack.AddData(&leftTexCoord, sizeof(glm::vec2));
-    vboTrack.AddData(&normal, sizeof(glm::vec3));
-
-    glm::vec3 rightPoint = m_rightOffsetPoints[0];
-    glm::vec2 rightTexCoord(1.0f, (float)numPoints / 10.0f);
-    vboTrack.AddData(&rightPoint, sizeof(glm::vec3));
-    vboTrack.AddData(&rightTexCoord, sizeof(glm::vec2));
-    vboTrack.AddData(&normal, sizeof(glm::vec3));
-
-    m_vertexCount = 2 * numPoints + 2;
-
-    vboTrack.UploadDataToGPU(GL_STATIC_DRAW);
-
-    GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride,
-        (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+    return (int)(d / m_distances.back());
 }
 
-void CCatmullRom::RenderCentreline()
-{
-    // Bind the VAO m_vaoCentreline and render it
-    glLineWidth(5.0f);
-    glBindVertexArray(m_vaoCentreline);
-    glDrawArrays(GL_POINT, 0, m_centrelinePoints.size());
-    glDrawArrays(GL_LINE_LOOP, 0, m_centrelinePoints.size());
-
-}
+glm::vec3 CCatmullRom::_dummy_vector(0.0f, 0.0f, 0.0f);
 
-void CCatmullRom::RenderOffsetCurves()
+float CCatmullRom::GetTrackLength()
 {
-    // Bind the VAO m_vaoLeftOffsetCurve and render it
-    glLineWidth(3.0f);
-    glBindVertexArray(m_vaoLeftOffsetCurve);
-    glDrawArrays(GL_POINTS, 0, m_leftOffsetPoints.size());
-    glDrawArrays(GL_LINE_LOOP, 0, m_leftOffsetPoints.size());
-
-    // Bind the VAO m_vaoRightOffsetCurve and render it
-    glBindVertexArray(m_vaoRightOffsetCurve);
-    glDrawArrays(GL_POINTS, 0, m_rightOffsetPoints.size());
-    glDrawArrays(GL_LINE_LOOP, 0, m_rightOffsetPoints.size());
+    // Return the total length of the track (the last value in the distances array)
+    if (m_distances.size() > 0)
+        return m_distances.back();
+    return 0.0f;
 }
 
-void CCatmullRom::RenderTrack()
+const vector<glm::vec3>& CCatmullRom::GetCentrelinePoints()
 {
-    // Bind the VAO m_vaoTrack and render it
-    glBindVertexArray(m_vaoTrack);
-    m_texture.Bind();
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, m_vertexCount);
+    return m_centrelinePoints;
 }
 
-int CCatmullRom::CurrentLap(float d)
+const vector<glm::vec3>& CCatmullRom::GetLeftOffsetPoints()
 {
-    return (int)(d / m_distances.back());
+    return m_leftOffsetPoints;
 }
 
-glm::vec3 CCatmullRom::_dummy_vector(0.0f, 0.0f, 0.0f);
-
-float CCatmullRom::GetTrackLength()
+const vector<glm::vec3>& CCatmullRom::GetRightOffsetPoints()
 {
-    // Return the total length of the track (the last value in the distances array)
-    if (m_distances.size() > 0)
-        return m_distances.back();
-    return 0.0f;
-}
\ No newline at end of file
+    return m_rightOffsetPoints;
+}
@@ -1,30 +1,63 @@
 #pragma once
-#include "Common.h"
-#include "vertexBufferObject.h"
-#include "vertexBufferObjectIndexed.h"
-#include "Texture.h"
+#include "CommonCore.h"
 
 
+// Remembers the segment found by the last spline query.  Coherent sequences of queries (a car moving along the track, or objects
+// placed at increasing distances) then only step one or two segments from the previous result instead of searching again.
+struct SplineCursor
+{
+	SplineCursor() : segment(-1) {}
+	int segment;
+};
+
+// A point on the centreline together with its frame, evaluated from the spline derivative rather than by differencing two samples
+struct SplineFrame
+{
+	glm::vec3 p;	// Point on the centreline
+	glm::vec3 T;	// Unit tangent, in the direction of travel
+	glm::vec3 N;	// Unit normal, across the track (T x world up)
+	glm::vec3 B;	// Unit binormal (N x T)
+	glm::vec3 up;	// Interpolated upvector, or world up if the spline has no control upvectors
+};
+
+// How FindSegment searches the arc-length table.  The game always uses the bucket index; the others are kept so that
+// SplineBenchmark.cpp can compare against them
+enum SegmentSearch
+{
+	SEGMENT_SEARCH_BUCKETS,		// Constant time, from the uniform bucket index
+	SEGMENT_SEARCH_BINARY,		// Logarithmic time
+	SEGMENT_SEARCH_LINEAR		// Linear time, scanning from the first segment
+};
+
+// The track model: control points, the arc-length parameterised centreline through them, and the offset curves.  This is
+// all CPU side; CTrackMesh turns it into vertex arrays
 class CCatmullRom
 {
 public:
 	CCatmullRom();
 	~CCatmullRom();
 
-	void CreateCentreline();
-	void RenderCentreline();
-
+	void CreateCentreline(int numSamples = 500);	// The centreline points become the control points of the arc-length table, so this also sets its size
 	void CreateOffsetCurves();
-	void RenderOffsetCurves();
-
-	void CreateTrack(string sDirectory, string sFilename);
-	void RenderTrack();
 
 	int CurrentLap(float d); // Return the currvent lap (starting from 0) based on distance along the control curve.
 
 	float GetTrackLength();
+	const vector<glm::vec3>& GetCentrelinePoints();
+	const vector<glm::vec3>& GetLeftOffsetPoints();
+	const vector<glm::vec3>& GetRightOffsetPoints();
 
 	bool Sample(float d, glm::vec3& p, glm::vec3& up = _dummy_vector); // Return a point on the centreline based on a certain distance along the control curve.
+	bool Sample(float d, SplineCursor& cursor, glm::vec3& p, glm::vec3& up = _dummy_vector); // As above, starting the segment search from the cursor
+	bool SampleFrame(float d, SplineFrame& frame);							// Return the point and T, N, B frame at distance d
+	bool SampleFrame(float d, SplineCursor& cursor, SplineFrame& frame);	// As above, starting the segment search from the cursor
+
+	// Evaluate the centreline at n distances at once.  Any of outUp / outTangent may be NULL; outUp is only written if the spline has control
+	// upvectors.  Distances are wrapped into one lap as in Sample, and the search is fastest when they are sorted.  Returns false without
+	// writing anything if any distance is negative, which Sample also rejects.
+	bool SampleMany(const float* distances, size_t n, glm::vec3* outPos, glm::vec3* outUp = NULL, glm::vec3* outTangent = NULL);
+
+	void SetSegmentSearch(SegmentSearch search);
 
 
 private:
@@ -32,26 +65,36 @@ private:
 	void SetControlPoints();
 	void ComputeLengthsAlongControlPoints();
 	void UniformlySampleControlPoints(int numSamples);
+	void BuildArcLengthTable();					// Build the bucket index over m_distances
+	bool WrapDistance(float d, float& fLength);	// Wrap d into one lap.  False if d is negative
+	int FindSegment(float fLength);				// Return the segment j such that m_distances[j] <= fLength < m_distances[j + 1]
+	int FindSegment(float fLength, SplineCursor& cursor); // As above, stepping from (and updating) the cursor
+	void BuildSegmentCoefficients();			// Convert the control points into per-segment cubic coefficients (structure of arrays)
+	void EvaluateSegments(const int* segments, const float* ts, size_t n, glm::vec3* outPos, glm::vec3* outUp, glm::vec3* outTangent);
+	void EvaluateSegmentsScalar(const int* segments, const float* ts, size_t n, glm::vec3* outPos, glm::vec3* outUp, glm::vec3* outTangent);
+	bool Locate(float d, SplineCursor& cursor, int& segment, float& t);	// Find the segment and parameter t at distance d
 	glm::vec3 Interpolate(glm::vec3& p0, glm::vec3& p1, glm::vec3& p2, glm::vec3& p3, float t);
+	glm::vec3 InterpolateDerivative(glm::vec3& p0, glm::vec3& p1, glm::vec3& p2, glm::vec3& p3, float t);
 
 
 	vector<float> m_distances;
-	CTexture m_texture;
+	vector<int> m_segmentBuckets;			// First segment overlapping each uniform arc-length bucket
+	float m_bucketLength;					// Arc length covered by one bucket
+	SegmentSearch m_segmentSearch;
 
-	GLuint m_vaoCentreline;
-	GLuint m_vaoLeftOffsetCurve;
-	GLuint m_vaoRightOffsetCurve;
-	GLuint m_vaoTrack;
+	// Cubic coefficients a + bt + ct^2 + dt^3 of each segment, stored as [component][power] arrays indexed by segment, so that
+	// SampleMany can load the same coefficient of several segments into one SIMD register
+	vector<float> m_positionCoeffs[3][4];
+	vector<float> m_upCoeffs[3][4];
 
 	static glm::vec3 _dummy_vector;
 	vector<glm::vec3> m_controlPoints;		// Control points, which are interpolated to produce the centreline points
 	vector<glm::vec3> m_controlUpVectors;	// Control upvectors, which are interpolated to produce the centreline upvectors
 	vector<glm::vec3> m_centrelinePoints;	// Centreline points
 	vector<glm::vec3> m_centrelineUpVectors;// Centreline upvectors
+	vector<glm::vec3> m_centrelineTangents;	// Unit tangents at the centreline points
 
 	vector<glm::vec3> m_leftOffsetPoints;	// Left offset curve points
 	vector<glm::vec3> m_rightOffsetPoints;	// Right offset curve points
 
-
-	unsigned int m_vertexCount;				// Number of vertices in the track VBO
 };
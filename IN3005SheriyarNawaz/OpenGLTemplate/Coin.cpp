@@ -22,10 +22,9 @@ void CCoin::Create(string a_sDirectory, string a_sFilename, int slicesIn, float
 	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
 	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
+	//Rim, both face centres and both face rings of vertices; two triangles per slice on the rim and one on each face
 	m_vbo.Create();
-	m_vbo.Bind();
+	m_vbo.Reserve(4 * (slicesIn + 1) + 2, 12 * slicesIn);
 
 	float radius = 1.0f;
 	float halfThickness = thickness / 2.0f;
@@ -48,18 +47,14 @@ void CCoin::Create(string a_sDirectory, string a_sFilename, int slicesIn, float
 		glm::vec3 nFront = glm::normalize(glm::vec3(x, y, 0.0f));
 
 		//Add front vertex data to VBO
-		m_vbo.AddVertexData(&vFront, sizeof(glm::vec3));
-		m_vbo.AddVertexData(&tFront, sizeof(glm::vec2));
-		m_vbo.AddVertexData(&nFront, sizeof(glm::vec3));
+		m_vbo.AddVertex(MeshVertex(vFront, tFront, nFront));
 		vertexCount++;
 
 		//Add back vertext data to VBO
 		glm::vec3 vBack = glm::vec3(x, y, -halfThickness);
 		glm::vec2 tBack = glm::vec2(i / (float)edgeVertices, 1.0f);
 		glm::vec3 nBack = glm::normalize(glm::vec3(x, y, 0.0f));
-		m_vbo.AddVertexData(&vBack, sizeof(glm::vec3));
-		m_vbo.AddVertexData(&tBack, sizeof(glm::vec2));
-		m_vbo.AddVertexData(&nBack, sizeof(glm::vec3));
+		m_vbo.AddVertex(MeshVertex(vBack, tBack, nBack));
 		vertexCount++;
 	}
 
@@ -67,18 +62,14 @@ void CCoin::Create(string a_sDirectory, string a_sFilename, int slicesIn, float
 	glm::vec3 frontCentre = glm::vec3(0.0f, 0.0f, halfThickness);
 	glm::vec2 frontCentreTexCoord = glm::vec2(0.5f, 0.5f);
 	glm::vec3 frontNormal = glm::vec3(0.0f, 0.0f, 1.0f);
-	m_vbo.AddVertexData(&frontCentre, sizeof(glm::vec3));
-	m_vbo.AddVertexData(&frontCentreTexCoord, sizeof(glm::vec2));
-	m_vbo.AddVertexData(&frontNormal, sizeof(glm::vec3));
+	m_vbo.AddVertex(MeshVertex(frontCentre, frontCentreTexCoord, frontNormal));
 	int frontCentreIndex = vertexCount++;
 
 	//Create vertices for back face centre of coin
 	glm::vec3 backCentre = glm::vec3(0.0f, 0.0f, -halfThickness);
 	glm::vec2 backCentreTexCoord = glm::vec2(0.5f, 0.5f);
 	glm::vec3 backNormal = glm::vec3(0.0f, 0.0f, -1.0f);
-	m_vbo.AddVertexData(&backCentre, sizeof(glm::vec3));
-	m_vbo.AddVertexData(&backCentreTexCoord, sizeof(glm::vec2));
-	m_vbo.AddVertexData(&backNormal, sizeof(glm::vec3));
+	m_vbo.AddVertex(MeshVertex(backCentre, backCentreTexCoord, backNormal));
 	int backCentreIndex = vertexCount++;
 
 	//Generate vertices for front and back faces
@@ -95,17 +86,13 @@ void CCoin::Create(string a_sDirectory, string a_sFilename, int slicesIn, float
 		glm::vec3 vertFront = glm::vec3(x, y, halfThickness);
 		glm::vec2 texFront = glm::vec2(texU, texV);
 		glm::vec3 normFront = glm::vec3(0.0f, 0.0f, 1.0f);
-		m_vbo.AddVertexData(&vertFront, sizeof(glm::vec3));
-		m_vbo.AddVertexData(&texFront, sizeof(glm::vec2));
-		m_vbo.AddVertexData(&normFront, sizeof(glm::vec3));
+		m_vbo.AddVertex(MeshVertex(vertFront, texFront, normFront));
 		vertexCount++;
 
 		glm::vec3 vertBack = glm::vec3(x, y, -halfThickness);
 		glm::vec2 texBack = glm::vec2(texU, texV);
 		glm::vec3 normBack = glm::vec3(0.0f, 0.0f, -1.0f);
-		m_vbo.AddVertexData(&vertBack, sizeof(glm::vec3));
-		m_vbo.AddVertexData(&texBack, sizeof(glm::vec2));
-		m_vbo.AddVertexData(&normBack, sizeof(glm::vec3));
+		m_vbo.AddVertex(MeshVertex(vertBack, texBack, normBack));
 		vertexCount++;
 	}
 	//Generate triangles for side of coin
@@ -116,14 +103,10 @@ void CCoin::Create(string a_sDirectory, string a_sFilename, int slicesIn, float
 		unsigned int index2 = index0 + 2;
 		unsigned int index3 = index1 + 2;
 
-		m_vbo.AddIndexData(&index1, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index2, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index0, sizeof(unsigned int));
+		m_vbo.AddTriangle(index1, index2, index0);
 		m_numTriangles++;
 
-		m_vbo.AddIndexData(&index3, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index2, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index1, sizeof(unsigned int));
+		m_vbo.AddTriangle(index3, index2, index1);
 		m_numTriangles++;
 	}
 	//Generate indices for front and back of coin
@@ -133,9 +116,7 @@ void CCoin::Create(string a_sDirectory, string a_sFilename, int slicesIn, float
 		unsigned int index2 = frontIndex + i * 2;
 		unsigned int index3 = frontIndex + (i + 1) * 2;
 
-		m_vbo.AddIndexData(&index1, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index2, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index3, sizeof(unsigned int));
+		m_vbo.AddTriangle(index1, index2, index3);
 		m_numTriangles++;
 	}
 
@@ -145,34 +126,39 @@ void CCoin::Create(string a_sDirectory, string a_sFilename, int slicesIn, float
 		unsigned int index2 = backIndex + (i + 1) * 2;
 		unsigned int index3 = backIndex + i * 2;
 
-		m_vbo.AddIndexData(&index1, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index2, sizeof(unsigned int));
-		m_vbo.AddIndexData(&index3, sizeof(unsigned int));
+		m_vbo.AddTriangle(index1, index2, index3);
 		m_numTriangles++;
 	}
 
-	m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
-	GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
-
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+	m_vbo.UploadDataToGPU();
 }
 
 void CCoin::Render()
 {
-	glBindVertexArray(m_vao);
+	const GeometryRange& range = m_vbo.GetRange();
+	m_vbo.Bind();
+	m_texture.Bind();
+	glDrawElementsBaseVertex(GL_TRIANGLES, m_numTriangles * 3, GL_UNSIGNED_INT, range.GetIndexOffset(), range.baseVertex);
+}
+
+// Render every visible instance in one draw call.  Transforms come from the instance buffer.
+void CCoin::RenderInstanced(CInstanceBuffer* pInstances)
+{
+	if (pInstances->GetNumInstances() == 0)
+		return;
+
+	const GeometryRange& range = m_vbo.GetRange();
+	m_vbo.Bind();
+	pInstances->Bind();
 	m_texture.Bind();
-	glDrawElements(GL_TRIANGLES, m_numTriangles * 3, GL_UNSIGNED_INT, 0);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_numTriangles * 3, GL_UNSIGNED_INT, range.GetIndexOffset(),
+		pInstances->GetNumInstances(), range.baseVertex);
+	pInstances->Unbind();
 }
 
 // Release memory on the GPU 
 void CCoin::Release()
 {
 	m_texture.Release();
-	glDeleteVertexArrays(1, &m_vao);
 	m_vbo.Release();
 }
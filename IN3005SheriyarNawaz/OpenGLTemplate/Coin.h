@@ -2,6 +2,7 @@
 #include "Common.h"
 #include "Texture.h"
 #include "VertexBufferObjectIndexed.h"
+#include "InstanceBuffer.h"
 class CCoin
 {
 public:
@@ -9,9 +10,9 @@ public:
     ~CCoin();
     void Create(string a_sDirectory, string a_sFilename, int slicesIn, float thickness);
     void Render();
+    void RenderInstanced(CInstanceBuffer* pInstances);
     void Release();
 private:
-    GLuint m_vao;
     CVertexBufferObjectIndexed m_vbo;
     CTexture m_texture;
     string m_directory;
@@ -0,0 +1,218 @@
+#include "CollectibleSet.h"
+
+// Distance tests use SSE2 when the compiler targets it, which every x64 CPU has
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLECTIBLESET_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Index of the lowest set bit of a non-zero word
+static int LowestSetBit(uint64_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+CCollectibleSet::CCollectibleSet()
+{
+	m_freeListHead = 0;
+}
+
+CCollectibleSet::~CCollectibleSet()
+{
+}
+
+void CCollectibleSet::Clear()
+{
+	m_x.clear();
+	m_y.clear();
+	m_z.clear();
+	m_collected.clear();
+	m_freeList.clear();
+	m_freeListHead = 0;
+}
+
+void CCollectibleSet::Reserve(int n)
+{
+	m_x.reserve(n);
+	m_y.reserve(n);
+	m_z.reserve(n);
+	m_collected.reserve((n + 63) / 64);
+}
+
+int CCollectibleSet::Add(const glm::vec3& position)
+{
+	int index = (int)m_x.size();
+	m_x.push_back(position.x);
+	m_y.push_back(position.y);
+	m_z.push_back(position.z);
+	if (index % 64 == 0)
+		m_collected.push_back(0);
+	return index;
+}
+
+int CCollectibleSet::GetSize() const
+{
+	return (int)m_x.size();
+}
+
+glm::vec3 CCollectibleSet::GetPosition(int index) const
+{
+	return glm::vec3(m_x[index], m_y[index], m_z[index]);
+}
+
+bool CCollectibleSet::IsCollected(int index) const
+{
+	return (m_collected[index / 64] >> (index % 64)) & 1;
+}
+
+void CCollectibleSet::Collect(int index)
+{
+	if (IsCollected(index))
+		return;
+
+	m_collected[index / 64] |= (uint64_t)1 << (index % 64);
+	m_freeList.push_back(index);
+}
+
+int CCollectibleSet::Respawn()
+{
+	if (m_freeListHead == m_freeList.size())
+		return -1;
+
+	int index = m_freeList[m_freeListHead++];
+	m_collected[index / 64] &= ~((uint64_t)1 << (index % 64));
+
+	// Reuse the storage once everything has been brought back
+	if (m_freeListHead == m_freeList.size()) {
+		m_freeList.clear();
+		m_freeListHead = 0;
+	}
+	return index;
+}
+
+void CCollectibleSet::RespawnAll()
+{
+	while (Respawn() != -1)
+		;
+}
+
+int CCollectibleSet::GetNumCollected() const
+{
+	return (int)(m_freeList.size() - m_freeListHead);
+}
+
+int CCollectibleSet::NextUncollected(int index) const
+{
+	return NextUncollected(m_collected, GetSize(), index);
+}
+
+// Skips whole words of collected objects at a time
+int CCollectibleSet::NextUncollected(const vector<uint64_t>& collectedMask, int size, int index)
+{
+	if (index < 0)
+		index = 0;
+	if (index >= size)
+		return -1;
+
+	int word = index / 64;
+	uint64_t uncollected = ~collectedMask[word] & (~(uint64_t)0 << (index % 64));
+	while (uncollected == 0) {
+		if (++word == (int)collectedMask.size())
+			return -1;
+		uncollected = ~collectedMask[word];
+	}
+
+	int next = word * 64 + LowestSetBit(uncollected);
+	return next < size ? next : -1;
+}
+
+const vector<uint64_t>& CCollectibleSet::GetCollectedMask() const
+{
+	return m_collected;
+}
+
+unsigned int CCollectibleSet::CollectedBits(int index) const
+{
+	int word = index / 64, bit = index % 64;
+	uint64_t bits = m_collected[word] >> bit;
+	if (bit > 60 && word + 1 < (int)m_collected.size())
+		bits |= m_collected[word + 1] << (64 - bit);
+	return (unsigned int)(bits & 0xF);
+}
+
+void CCollectibleSet::FindWithin(const glm::vec3& centre, float radius, int first, int count, vector<int>& hits) const
+{
+	int end = glm::min(first + count, GetSize());
+	float radiusSquared = radius * radius;
+	int i = glm::max(first, 0);
+
+#ifdef COLLECTIBLESET_SSE2
+	// Four objects at a time: squared distances are compared in one go, then the collected bits mask out the lanes
+	__m128 cx = _mm_set1_ps(centre.x);
+	__m128 cy = _mm_set1_ps(centre.y);
+	__m128 cz = _mm_set1_ps(centre.z);
+	__m128 r2 = _mm_set1_ps(radiusSquared);
+	for (; i + 4 <= end; i += 4) {
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&m_x[i]), cx);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&m_y[i]), cy);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(&m_z[i]), cz);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		unsigned int lanes = _mm_movemask_ps(_mm_cmplt_ps(d2, r2)) & ~CollectedBits(i);
+		for (int lane = 0; lanes != 0; lane++, lanes >>= 1) {
+			if (lanes & 1)
+				hits.push_back(i + lane);
+		}
+	}
+#endif
+
+	for (; i < end; i++) {
+		float dx = m_x[i] - centre.x, dy = m_y[i] - centre.y, dz = m_z[i] - centre.z;
+		if (!IsCollected(i) && dx * dx + dy * dy + dz * dz < radiusSquared)
+			hits.push_back(i);
+	}
+}
+
+void CCollectibleSet::FindWithin(const glm::vec3& centre, float radius, const vector<int>& candidates, vector<int>& hits) const
+{
+	float radiusSquared = radius * radius;
+	size_t c = 0;
+
+#ifdef COLLECTIBLESET_SSE2
+	// Candidates are scattered, so gather four into registers and test them together
+	__m128 cx = _mm_set1_ps(centre.x);
+	__m128 cy = _mm_set1_ps(centre.y);
+	__m128 cz = _mm_set1_ps(centre.z);
+	__m128 r2 = _mm_set1_ps(radiusSquared);
+	for (; c + 4 <= candidates.size(); c += 4) {
+		const int* j = &candidates[c];
+		__m128 dx = _mm_sub_ps(_mm_set_ps(m_x[j[3]], m_x[j[2]], m_x[j[1]], m_x[j[0]]), cx);
+		__m128 dy = _mm_sub_ps(_mm_set_ps(m_y[j[3]], m_y[j[2]], m_y[j[1]], m_y[j[0]]), cy);
+		__m128 dz = _mm_sub_ps(_mm_set_ps(m_z[j[3]], m_z[j[2]], m_z[j[1]], m_z[j[0]]), cz);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		unsigned int lanes = _mm_movemask_ps(_mm_cmplt_ps(d2, r2));
+		for (int lane = 0; lanes != 0; lane++, lanes >>= 1) {
+			if ((lanes & 1) && !IsCollected(j[lane]))
+				hits.push_back(j[lane]);
+		}
+	}
+#endif
+
+	for (; c < candidates.size(); c++) {
+		int i = candidates[c];
+		float dx = m_x[i] - centre.x, dy = m_y[i] - centre.y, dz = m_z[i] - centre.z;
+		if (!IsCollected(i) && dx * dx + dy * dy + dz * dz < radiusSquared)
+			hits.push_back(i);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CommonCore.h"
+#include <stdint.h>
+
+// A set of objects placed along the track (coins, tyres...), stored as separate x, y, z arrays so that several
+// objects can be tested against the car at once with SIMD.  Whether each object has been collected is one bit in
+// a packed mask; collected objects go on a free list so they can be brought back in the order they were taken.
+class CCollectibleSet
+{
+public:
+	CCollectibleSet();
+	~CCollectibleSet();
+
+	void Clear();
+	void Reserve(int n);
+	int Add(const glm::vec3& position);			// Adds an uncollected object and returns its index
+
+	int GetSize() const;
+	glm::vec3 GetPosition(int index) const;
+
+	bool IsCollected(int index) const;
+	void Collect(int index);					// Marks an object as collected and puts it on the free list
+	int Respawn();								// Brings back the earliest collected object and returns its index, or -1 if there are none
+	void RespawnAll();
+	int GetNumCollected() const;
+	int NextUncollected(int index) const;		// First uncollected object at or after index, or -1
+	static int NextUncollected(const vector<uint64_t>& collectedMask, int size, int index);	// The same, on a copy of the mask
+	const vector<uint64_t>& GetCollectedMask() const;
+
+	// Appends the uncollected objects strictly within radius of centre, either from a range of indices or from a list of candidates
+	void FindWithin(const glm::vec3& centre, float radius, int first, int count, vector<int>& hits) const;
+	void FindWithin(const glm::vec3& centre, float radius, const vector<int>& candidates, vector<int>& hits) const;
+
+private:
+	unsigned int CollectedBits(int index) const;	// Collected bits of objects index to index + 3, in the low four bits
+
+	vector<float> m_x;
+	vector<float> m_y;
+	vector<float> m_z;
+	vector<uint64_t> m_collected;				// Bit i % 64 of word i / 64 is set when object i has been collected
+	vector<int> m_freeList;						// Collected objects, oldest first
+	size_t m_freeListHead;						// Next entry of m_freeList to respawn
+};
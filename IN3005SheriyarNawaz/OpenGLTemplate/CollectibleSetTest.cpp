@@ -0,0 +1,115 @@
+/*
+ Behaviour test for the collected bitmask of CCollectibleSet: collecting, counting, NextUncollected (also on a copy of
+ the mask, as CullInstances uses it), respawn order and FindWithin skipping collected objects.  Objects are chosen on
+ both sides of the 64-bit word boundaries.  Prints each failed check and returns non-zero if there were any.
+
+ Not part of the Windows build (it has its own main).  On Linux, from this directory:
+
+   g++ -O2 -std=c++17 -I. CollectibleSetTest.cpp CollectibleSet.cpp -o collectible_set_test
+*/
+
+#include "CollectibleSet.h"
+#include <stdio.h>
+
+static int s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			printf("%s(%d): failed %s\n", __FILE__, __LINE__, #condition); \
+			s_failures++; \
+		} \
+	} while (0)
+
+int main()
+{
+	// 200 objects one unit apart along x, so 4 words with the last one partly used
+	const int size = 200;
+	CCollectibleSet set;
+	set.Reserve(size);
+	for (int i = 0; i < size; i++)
+		CHECK(set.Add(glm::vec3((float)i, 0.0f, 0.0f)) == i);
+
+	CHECK(set.GetSize() == size);
+	CHECK(set.GetCollectedMask().size() == 4);
+	CHECK(set.GetNumCollected() == 0);
+	CHECK(set.NextUncollected(0) == 0);
+	CHECK(set.NextUncollected(size - 1) == size - 1);
+	CHECK(set.NextUncollected(size) == -1);
+
+	// Collect a run over the first word boundary and a few singles, in no particular order
+	const int order[] = { 130, 62, 63, 64, 65, 0, 199 };
+	const int numCollected = sizeof(order) / sizeof(order[0]);
+	for (int c = 0; c < numCollected; c++)
+		set.Collect(order[c]);
+	set.Collect(63);	// Already collected, so not counted again or put on the free list twice
+
+	CHECK(set.GetNumCollected() == numCollected);
+	for (int c = 0; c < numCollected; c++)
+		CHECK(set.IsCollected(order[c]));
+	CHECK(!set.IsCollected(1));
+	CHECK(!set.IsCollected(61));
+	CHECK(!set.IsCollected(66));
+
+	CHECK(set.NextUncollected(0) == 1);
+	CHECK(set.NextUncollected(62) == 66);
+	CHECK(set.NextUncollected(129) == 129);
+	CHECK(set.NextUncollected(130) == 131);
+	CHECK(set.NextUncollected(199) == -1);
+	CHECK(set.NextUncollected(-5) == 1);
+
+	// Every object is either collected or visited exactly once by the iteration
+	int visited = 0;
+	for (int i = set.NextUncollected(0); i != -1; i = set.NextUncollected(i + 1)) {
+		CHECK(!set.IsCollected(i));
+		visited++;
+	}
+	CHECK(visited == size - numCollected);
+
+	// A copy of the mask, as in a race snapshot, gives the same answers
+	vector<uint64_t> mask = set.GetCollectedMask();
+	for (int i = 0; i <= size; i++)
+		CHECK(CCollectibleSet::NextUncollected(mask, size, i) == set.NextUncollected(i));
+
+	// A whole word collected is skipped in one go
+	for (int i = 64; i < 128; i++)
+		set.Collect(i);
+	CHECK(set.NextUncollected(61) == 61);
+	CHECK(set.NextUncollected(62) == 128);
+
+	// Collected objects are never found: of 61 to 65, only 61 is left
+	vector<int> hits;
+	set.FindWithin(glm::vec3(63.0f, 0.0f, 0.0f), 2.5f, 0, size, hits);
+	CHECK(hits.size() == 1 && hits[0] == 61);
+	hits.clear();
+	vector<int> candidates;
+	for (int i = 55; i < 70; i++)
+		candidates.push_back(i);
+	set.FindWithin(glm::vec3(63.0f, 0.0f, 0.0f), 2.5f, candidates, hits);
+	CHECK(hits.size() == 1 && hits[0] == 61);
+
+	// Respawn brings objects back oldest first
+	for (int c = 0; c < numCollected; c++) {
+		int respawned = set.Respawn();
+		CHECK(respawned == order[c]);
+		CHECK(!set.IsCollected(order[c]));
+	}
+	CHECK(set.GetNumCollected() == 128 - 66);	// 66 to 127 are still collected, and come back next
+	CHECK(set.Respawn() == 66);
+
+	set.RespawnAll();
+	CHECK(set.GetNumCollected() == 0);
+	CHECK(set.Respawn() == -1);
+	for (size_t w = 0; w < set.GetCollectedMask().size(); w++)
+		CHECK(set.GetCollectedMask()[w] == 0);
+
+	// The free list is reused after everything has come back
+	set.Collect(5);
+	set.Collect(3);
+	CHECK(set.Respawn() == 5);
+	CHECK(set.Respawn() == 3);
+	CHECK(set.Respawn() == -1);
+
+	printf(s_failures == 0 ? "All checks passed\n" : "%d checks failed\n", s_failures);
+	return s_failures == 0 ? 0 : 1;
+}
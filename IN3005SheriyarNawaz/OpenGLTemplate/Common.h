@@ -1,18 +1,16 @@
-#include <ctime>
+#ifdef _WIN32
 #include <windows.h>
 
-#include <cstring>
-#include <vector>
-#include <sstream>
-
-#include "./include/glm/gtc/type_ptr.hpp"
-#include "./include/glm/gtc/matrix_transform.hpp"
-#include "./include/glm/gtx/rotate_vector.hpp"
-
 #include "include/gl/glew.h"
 #include <gl/gl.h>
+#else
+// Offscreen builds on other platforms (RenderBenchmark.cpp) link against the system GL, which exports every core
+// entry point, and use a few stand-ins for the Windows API
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include "PlatformCompat.h"
+#endif
 
-using namespace std;
+#include "CommonCore.h"
@@ -0,0 +1,18 @@
+#pragma once
+
+// The standard library and maths headers every file uses.  Nothing here needs Windows or OpenGL, so the track model and
+// race simulation, which only include this, also build on other platforms (see HeadlessRace.cpp)
+#include <ctime>
+
+#include <cstring>
+#include <vector>
+#include <sstream>
+
+#include "./include/glm/gtc/type_ptr.hpp"
+#include "./include/glm/gtc/matrix_transform.hpp"
+#include "./include/glm/gtx/rotate_vector.hpp"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+using namespace std;
@@ -27,11 +27,7 @@ void CCone::Create(string a_sDirectory, string a_sFilename)
     m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
     m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-
     m_vbo.Create();
-    m_vbo.Bind();
 
     // Define parameters for the cone
     const int NUM_SEGMENTS = 32;
@@ -95,42 +91,31 @@ void CCone::Create(string a_sDirectory, string a_sFilename)
     }
 
     // Upload vertex data to GPU
+    m_vbo.Reserve(NUM_VERTICES, (int)indices.size());
     for (int i = 0; i < NUM_VERTICES; i++) {
-        m_vbo.AddVertexData(&vertices[i], sizeof(glm::vec3));
-        m_vbo.AddVertexData(&texCoords[i], sizeof(glm::vec2));
-        m_vbo.AddVertexData(&normals[i], sizeof(glm::vec3));
+        m_vbo.AddVertex(MeshVertex(vertices[i], texCoords[i], normals[i]));
     }
 
     // Upload index data to GPU
-    for (size_t i = 0; i < indices.size(); i++) {
-        m_vbo.AddIndexData(&indices[i], sizeof(unsigned int));
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        m_vbo.AddTriangle(indices[i], indices[i + 1], indices[i + 2]);
     }
 
-    m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
-
-    GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+    m_vbo.UploadDataToGPU();
     m_numIndices = static_cast<GLsizei>(indices.size());
 }
 
 void CCone::Render()
 {
-    glBindVertexArray(m_vao);
+    const GeometryRange& range = m_vbo.GetRange();
+    m_vbo.Bind();
     m_texture.Bind();
-    glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0);
+    glDrawElementsBaseVertex(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, range.GetIndexOffset(), range.baseVertex);
 }
 
 // Release memory on the GPU
 void CCone::Release()
 {
     m_texture.Release();
-    glDeleteVertexArrays(1, &m_vao);
     m_vbo.Release();
 }
\ No newline at end of file
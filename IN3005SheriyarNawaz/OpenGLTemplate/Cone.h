@@ -21,7 +21,6 @@ public:
     void Release();
 
 private:
-    GLuint m_vao;                  // Vertex array object
     CVertexBufferObjectIndexed m_vbo;     // Vertex buffer object
     CTexture m_texture;            // Texture
     string m_directory;            // Directory for resources
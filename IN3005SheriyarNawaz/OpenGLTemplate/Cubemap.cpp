@@ -1,6 +1,7 @@
 #include "Common.h"
 
 #include "Cubemap.h"
+#include "GLStateCache.h"
 
 
 #include "include\freeimage\FreeImage.h"
@@ -60,9 +61,8 @@ bool CCubemap::LoadTexture(string filename, BYTE **bmpBytes, int &iWidth, int &i
 // Binds a texture for rendering
 void CCubemap::Bind(int iTextureUnit)
 {
-	glActiveTexture(GL_TEXTURE0+iTextureUnit);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_uiTexture);
-	glBindSampler(iTextureUnit, m_uiSampler);
+	CGLStateCache::BindTexture(iTextureUnit, GL_TEXTURE_CUBE_MAP, m_uiTexture);
+	CGLStateCache::BindSampler(iTextureUnit, m_uiSampler);
 }
 
 
@@ -73,7 +73,7 @@ void CCubemap::Create(string sPositiveX, string sNegativeX, string sPositiveY, s
 
 	// Generate an OpenGL texture ID for this texture
 	glGenTextures(1, &m_uiTexture);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_uiTexture);
+	CGLStateCache::BindTexture(0, GL_TEXTURE_CUBE_MAP, m_uiTexture);
 
 	// Load the six sides
 	BYTE *pbImagePosX, *pbImageNegX, *pbImagePosY, *pbImageNegY, *pbImagePosZ, *pbImageNegZ;
@@ -116,6 +116,6 @@ void CCubemap::Create(string sPositiveX, string sNegativeX, string sPositiveY, s
 // Release resources
 void CCubemap::Release()
 {
-	glDeleteSamplers(1, &m_uiSampler);
-	glDeleteTextures(1, &m_uiTexture);
+	CGLStateCache::DeleteSampler(m_uiSampler);
+	CGLStateCache::DeleteTexture(m_uiTexture);
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "FreeTypeFont.h"
+#include "GLStateCache.h"
+#include "Profiler.h"
 #include <minmax.h>
 
 #pragma comment(lib, "lib/freetype.lib")
@@ -69,10 +71,8 @@ void CFreeTypeFont::CreateChar(int index)
 	glm::vec2 vTexQuad[] = {glm::vec2(0.0f, 1.0f), glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(1.0f, 0.0f)};
 
 	// Add this char to VBO
-	for (int i = 0; i < 4; i++) {
-		m_vbo.AddData(&vQuad[i], sizeof(glm::vec2));
-		m_vbo.AddData(&vTexQuad[i], sizeof(glm::vec2));
-	}
+	for (int i = 0; i < 4; i++)
+		m_vbo.AddVertex(TextVertex(vQuad[i], vTexQuad[i]));
 	delete[] bData;
 }
 
@@ -92,10 +92,8 @@ bool CFreeTypeFont::LoadFont(string file, int ipixelSize)
 	FT_Set_Pixel_Sizes(m_ftFace, ipixelSize, ipixelSize);
 	m_loadedPixelSize = ipixelSize;
 
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
-	m_vbo.Create();
-	m_vbo.Bind();
+	m_vbo.Create(VERTEX_FORMAT_TEXT);
+	m_vbo.Reserve(128 * 4);		// A quad per character
 
 	for (int i = 0; i < 128; i++)
 		CreateChar(i);
@@ -104,11 +102,7 @@ bool CFreeTypeFont::LoadFont(string file, int ipixelSize)
 	FT_Done_Face(m_ftFace);
 	FT_Done_FreeType(m_ftLib);
 	
-	m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2)*2, 0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2)*2, (void*)(sizeof(glm::vec2)));
+	m_vbo.UploadDataToGPU();
 	return true;
 }
 
@@ -127,13 +121,17 @@ bool CFreeTypeFont::LoadSystemFont(string name, int ipixelSize)
 // Prints text at the specified location (x, y) with the given pixel size (iPXSize)
 void CFreeTypeFont::Print(string text, int x, int y, int pixelSize)
 {
+	PROFILE_ZONE("CFreeTypeFont::Print");
 	if(!m_isLoaded)
 		return;
 
-	glBindVertexArray(m_vao);
+	m_vbo.Bind();
+	GLint firstVertex = m_vbo.GetRange().baseVertex;
 	m_shaderProgram->SetUniform("sampler0", 0);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// Blending is left on afterwards, so printing several strings in a row only turns it on once.  Game::Render
+	// turns it off again before the 3D scene
+	CGLStateCache::Enable(GL_BLEND);
+	CGLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	int iCurX = x, iCurY = y;
 	if (pixelSize == -1)
 		pixelSize = m_loadedPixelSize;
@@ -154,12 +152,11 @@ void CFreeTypeFont::Print(string text, int x, int y, int pixelSize)
 			mModelView = glm::scale(mModelView, glm::vec3(fScale));
 			m_shaderProgram->SetUniform("matrices.modelViewMatrix", mModelView);
 			// Draw character
-			glDrawArrays(GL_TRIANGLE_STRIP, iIndex*4, 4);
+			glDrawArrays(GL_TRIANGLE_STRIP, firstVertex + iIndex*4, 4);
 		}
 
 		iCurX += (m_advX[iIndex] - m_bearingX[iIndex])*pixelSize / m_loadedPixelSize;
 	}
-	glDisable(GL_BLEND);
 }
 
 
@@ -180,7 +177,6 @@ void CFreeTypeFont::ReleaseFont()
 	for (int i = 0; i < 128; i++) 
 		m_charTextures[i].Release();
 	m_vbo.Release();
-	glDeleteVertexArrays(1, &m_vao);
 }
 
 // Gets the width of text
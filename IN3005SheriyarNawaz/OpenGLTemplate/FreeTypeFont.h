@@ -40,7 +40,6 @@ private:
 
 	bool m_isLoaded;
 
-	UINT m_vao;
 	CVertexBufferObject m_vbo;
 
 	FT_Library m_ftLib;
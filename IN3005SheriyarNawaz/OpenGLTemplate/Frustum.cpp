@@ -0,0 +1,148 @@
+#include "Frustum.h"
+
+CFrustum::CFrustum()
+{
+}
+
+CFrustum::~CFrustum()
+{
+}
+
+// Extract the planes from the rows of the combined matrix (Gribb and Hartmann)
+void CFrustum::Update(const glm::mat4& projMatrix, const glm::mat4& viewMatrix)
+{
+	glm::mat4 m = glm::transpose(projMatrix * viewMatrix);	// Columns of the transpose are rows of the original
+
+	m_planes[0] = m[3] + m[0];	// Left
+	m_planes[1] = m[3] - m[0];	// Right
+	m_planes[2] = m[3] + m[1];	// Bottom
+	m_planes[3] = m[3] - m[1];	// Top
+	m_planes[4] = m[3] + m[2];	// Near
+	m_planes[5] = m[3] - m[2];	// Far
+
+	for (int i = 0; i < 6; i++)
+		m_planes[i] /= glm::length(glm::vec3(m_planes[i]));
+}
+
+CFrustum::Result CFrustum::TestSphere(const BoundingSphere& sphere) const
+{
+	Result result = INSIDE;
+	for (int i = 0; i < 6; i++) {
+		float distance = glm::dot(glm::vec3(m_planes[i]), sphere.centre) + m_planes[i].w;
+		if (distance < -sphere.radius)
+			return OUTSIDE;
+		if (distance < sphere.radius)
+			result = INTERSECTS;
+	}
+	return result;
+}
+
+bool CFrustum::IsSphereVisible(const BoundingSphere& sphere) const
+{
+	return TestSphere(sphere) != OUTSIDE;
+}
+
+// The box is outside if its corner furthest along a plane normal is behind that plane
+bool CFrustum::IsBoxVisible(const BoundingBox& box) const
+{
+	for (int i = 0; i < 6; i++) {
+		glm::vec3 corner(m_planes[i].x >= 0.0f ? box.max.x : box.min.x,
+						 m_planes[i].y >= 0.0f ? box.max.y : box.min.y,
+						 m_planes[i].z >= 0.0f ? box.max.z : box.min.z);
+		if (glm::dot(glm::vec3(m_planes[i]), corner) + m_planes[i].w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+
+CBoundingSphereTree::CBoundingSphereTree()
+{
+}
+
+CBoundingSphereTree::~CBoundingSphereTree()
+{
+}
+
+void CBoundingSphereTree::Build(const vector<BoundingSphere>& leaves)
+{
+	m_leaves = leaves;
+	m_nodes.clear();
+	if (!m_leaves.empty()) {
+		m_nodes.reserve(2 * m_leaves.size());
+		BuildNode(0, (int)m_leaves.size());
+	}
+}
+
+// Build the node covering leaves [first, first + count) and return its index
+int CBoundingSphereTree::BuildNode(int first, int count)
+{
+	int index = (int)m_nodes.size();
+	m_nodes.push_back(Node());
+	m_nodes[index].first = first;
+	m_nodes[index].count = count;
+
+	if (count == 1) {
+		m_nodes[index].sphere = m_leaves[first];
+		m_nodes[index].left = m_nodes[index].right = -1;
+		return index;
+	}
+
+	int half = count / 2;
+	int left = BuildNode(first, half);
+	int right = BuildNode(first + half, count - half);
+
+	// Smallest sphere around the two child spheres
+	const BoundingSphere& a = m_nodes[left].sphere;
+	const BoundingSphere& b = m_nodes[right].sphere;
+	BoundingSphere sphere;
+	float d = glm::length(b.centre - a.centre);
+	if (d + b.radius <= a.radius)
+		sphere = a;
+	else if (d + a.radius <= b.radius)
+		sphere = b;
+	else {
+		sphere.radius = (d + a.radius + b.radius) * 0.5f;
+		sphere.centre = a.centre + (b.centre - a.centre) * ((sphere.radius - a.radius) / d);
+	}
+
+	m_nodes[index].sphere = sphere;
+	m_nodes[index].left = left;
+	m_nodes[index].right = right;
+	return index;
+}
+
+void CBoundingSphereTree::Query(const CFrustum& frustum, vector<int>& visibleLeaves, CullStats* pStats) const
+{
+	size_t before = visibleLeaves.size();
+	if (!m_nodes.empty())
+		QueryNode(0, frustum, visibleLeaves);
+
+	if (pStats) {
+		int visible = (int)(visibleLeaves.size() - before);
+		pStats->visible += visible;
+		pStats->culled += (int)m_leaves.size() - visible;
+	}
+}
+
+void CBoundingSphereTree::QueryNode(int node, const CFrustum& frustum, vector<int>& visibleLeaves) const
+{
+	const Node& n = m_nodes[node];
+	CFrustum::Result result = frustum.TestSphere(n.sphere);
+	if (result == CFrustum::OUTSIDE)
+		return;
+
+	if (result == CFrustum::INSIDE || n.left < 0) {
+		for (int i = n.first; i < n.first + n.count; i++)
+			visibleLeaves.push_back(i);
+		return;
+	}
+
+	QueryNode(n.left, frustum, visibleLeaves);
+	QueryNode(n.right, frustum, visibleLeaves);
+}
+
+int CBoundingSphereTree::GetNumLeaves() const
+{
+	return (int)m_leaves.size();
+}
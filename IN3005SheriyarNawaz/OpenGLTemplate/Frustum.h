@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Common.h"
+
+struct BoundingSphere
+{
+	BoundingSphere() : centre(0.0f), radius(0.0f) {}
+	BoundingSphere(const glm::vec3& c, float r) : centre(c), radius(r) {}
+	glm::vec3 centre;
+	float radius;
+};
+
+struct BoundingBox
+{
+	BoundingBox() : min(0.0f), max(0.0f) {}
+	BoundingBox(const glm::vec3& lo, const glm::vec3& hi) : min(lo), max(hi) {}
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// Visible and culled counts, accumulated over a frame
+struct CullStats
+{
+	CullStats() : visible(0), culled(0) {}
+	int visible;
+	int culled;
+};
+
+// The six planes of the view frustum, extracted from a projection * view matrix.  Planes are stored in world
+// coordinates with normals pointing into the frustum.
+class CFrustum
+{
+public:
+	enum Result { OUTSIDE, INTERSECTS, INSIDE };
+
+	CFrustum();
+	~CFrustum();
+
+	void Update(const glm::mat4& projMatrix, const glm::mat4& viewMatrix);
+	Result TestSphere(const BoundingSphere& sphere) const;
+	bool IsSphereVisible(const BoundingSphere& sphere) const;
+	bool IsBoxVisible(const BoundingBox& box) const;
+
+private:
+	glm::vec4 m_planes[6];	// (normal, distance): left, right, bottom, top, near, far
+};
+
+// A binary tree of bounding spheres over a set of objects.  Leaves are split in the order they are given, so
+// pass objects that are already spatially coherent (e.g. in order along the track).  A whole subtree is
+// skipped when its sphere is outside the frustum and accepted without further tests when it is inside.
+class CBoundingSphereTree
+{
+public:
+	CBoundingSphereTree();
+	~CBoundingSphereTree();
+
+	void Build(const vector<BoundingSphere>& leaves);
+	void Query(const CFrustum& frustum, vector<int>& visibleLeaves, CullStats* pStats = NULL) const;	// Appends visible leaf indices in ascending order
+
+	int GetNumLeaves() const;
+
+private:
+	struct Node
+	{
+		BoundingSphere sphere;
+		int first, count;	// Range of leaves below this node
+		int left, right;	// Child nodes, -1 for a leaf
+	};
+
+	int BuildNode(int first, int count);
+	void QueryNode(int node, const CFrustum& frustum, vector<int>& visibleLeaves) const;
+
+	vector<BoundingSphere> m_leaves;
+	vector<Node> m_nodes;
+};
@@ -0,0 +1,236 @@
+#include "GLStateCache.h"
+
+// Marks state the cache has not seen set, so the next call of that kind is always issued
+static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+static const int NUM_TEXTURE_TARGETS = 3;
+static const GLenum s_textureTargets[NUM_TEXTURE_TARGETS] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER };
+
+static const int NUM_CAPABILITIES = 3;
+static const GLenum s_capabilities[NUM_CAPABILITIES] = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE };
+
+static GLuint s_program = UNKNOWN;
+static GLuint s_vao = UNKNOWN;
+static GLuint s_activeUnit = UNKNOWN;
+static GLuint s_textures[CGLStateCache::MAX_TEXTURE_UNITS][NUM_TEXTURE_TARGETS];
+static GLuint s_samplers[CGLStateCache::MAX_TEXTURE_UNITS];
+static GLuint s_capabilityEnabled[NUM_CAPABILITIES];	// 0, 1 or UNKNOWN
+static GLenum s_blendSource = UNKNOWN;
+static GLenum s_blendDestination = UNKNOWN;
+static GLuint s_depthMask = UNKNOWN;
+
+static GLStateCounters s_counters;
+
+// Fills the texture and sampler tables with UNKNOWN before main, so they start out unknown like the rest
+static struct GLStateCacheInitialiser
+{
+	GLStateCacheInitialiser() { CGLStateCache::Invalidate(); }
+} s_initialiser;
+
+// Records the call and returns true if it has to reach OpenGL
+static bool Changes(GLStateCall call, GLuint& cached, GLuint value)
+{
+	if (cached == value) {
+		s_counters.skipped[call]++;
+		return false;
+	}
+	cached = value;
+	s_counters.issued[call]++;
+	return true;
+}
+
+static int FindTextureTarget(GLenum target)
+{
+	for (int i = 0; i < NUM_TEXTURE_TARGETS; i++) {
+		if (s_textureTargets[i] == target)
+			return i;
+	}
+	return -1;
+}
+
+static int FindCapability(GLenum capability)
+{
+	for (int i = 0; i < NUM_CAPABILITIES; i++) {
+		if (s_capabilities[i] == capability)
+			return i;
+	}
+	return -1;
+}
+
+GLStateCounters::GLStateCounters()
+{
+	for (int i = 0; i < NUM_STATE_CALLS; i++) {
+		issued[i] = 0;
+		skipped[i] = 0;
+	}
+}
+
+int GLStateCounters::GetTotalIssued() const
+{
+	int total = 0;
+	for (int i = 0; i < NUM_STATE_CALLS; i++)
+		total += issued[i];
+	return total;
+}
+
+int GLStateCounters::GetTotalSkipped() const
+{
+	int total = 0;
+	for (int i = 0; i < NUM_STATE_CALLS; i++)
+		total += skipped[i];
+	return total;
+}
+
+void CGLStateCache::UseProgram(GLuint program)
+{
+	if (Changes(STATE_CALL_PROGRAM, s_program, program))
+		glUseProgram(program);
+}
+
+void CGLStateCache::BindVertexArray(GLuint vao)
+{
+	if (Changes(STATE_CALL_VERTEX_ARRAY, s_vao, vao))
+		glBindVertexArray(vao);
+}
+
+void CGLStateCache::ActiveTexture(GLuint unit)
+{
+	if (Changes(STATE_CALL_ACTIVE_TEXTURE, s_activeUnit, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void CGLStateCache::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	int targetIndex = FindTextureTarget(target);
+	if (unit >= (GLuint)MAX_TEXTURE_UNITS || targetIndex < 0) {
+		ActiveTexture(unit);
+		glBindTexture(target, texture);
+		s_counters.issued[STATE_CALL_TEXTURE]++;
+		return;
+	}
+
+	// The unit only has to be made active if the binding on it changes
+	if (s_textures[unit][targetIndex] == texture) {
+		s_counters.skipped[STATE_CALL_TEXTURE]++;
+		return;
+	}
+	ActiveTexture(unit);
+	Changes(STATE_CALL_TEXTURE, s_textures[unit][targetIndex], texture);
+	glBindTexture(target, texture);
+}
+
+void CGLStateCache::BindSampler(GLuint unit, GLuint sampler)
+{
+	if (unit >= (GLuint)MAX_TEXTURE_UNITS) {
+		glBindSampler(unit, sampler);
+		s_counters.issued[STATE_CALL_SAMPLER]++;
+		return;
+	}
+
+	if (Changes(STATE_CALL_SAMPLER, s_samplers[unit], sampler))
+		glBindSampler(unit, sampler);
+}
+
+void CGLStateCache::SetCapability(GLenum capability, bool enabled)
+{
+	int index = FindCapability(capability);
+	if (index >= 0 && !Changes(STATE_CALL_CAPABILITY, s_capabilityEnabled[index], enabled ? 1 : 0))
+		return;
+	if (index < 0)
+		s_counters.issued[STATE_CALL_CAPABILITY]++;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void CGLStateCache::Enable(GLenum capability)
+{
+	SetCapability(capability, true);
+}
+
+void CGLStateCache::Disable(GLenum capability)
+{
+	SetCapability(capability, false);
+}
+
+void CGLStateCache::BlendFunc(GLenum source, GLenum destination)
+{
+	if (s_blendSource == source && s_blendDestination == destination) {
+		s_counters.skipped[STATE_CALL_BLEND_FUNC]++;
+		return;
+	}
+	s_blendSource = source;
+	s_blendDestination = destination;
+	s_counters.issued[STATE_CALL_BLEND_FUNC]++;
+	glBlendFunc(source, destination);
+}
+
+void CGLStateCache::DepthMask(bool write)
+{
+	if (Changes(STATE_CALL_DEPTH_MASK, s_depthMask, write ? 1 : 0))
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+// A deleted program stays in use until another one replaces it, so only forget it rather than assume 0
+void CGLStateCache::DeleteProgram(GLuint program)
+{
+	glDeleteProgram(program);
+	if (s_program == program)
+		s_program = UNKNOWN;
+}
+
+void CGLStateCache::DeleteVertexArray(GLuint vao)
+{
+	glDeleteVertexArrays(1, &vao);
+	if (s_vao == vao)
+		s_vao = 0;
+}
+
+void CGLStateCache::DeleteTexture(GLuint texture)
+{
+	glDeleteTextures(1, &texture);
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		for (int target = 0; target < NUM_TEXTURE_TARGETS; target++) {
+			if (s_textures[unit][target] == texture)
+				s_textures[unit][target] = 0;
+		}
+	}
+}
+
+void CGLStateCache::DeleteSampler(GLuint sampler)
+{
+	glDeleteSamplers(1, &sampler);
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		if (s_samplers[unit] == sampler)
+			s_samplers[unit] = 0;
+	}
+}
+
+void CGLStateCache::Invalidate()
+{
+	s_program = UNKNOWN;
+	s_vao = UNKNOWN;
+	s_activeUnit = UNKNOWN;
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+		for (int target = 0; target < NUM_TEXTURE_TARGETS; target++)
+			s_textures[unit][target] = UNKNOWN;
+		s_samplers[unit] = UNKNOWN;
+	}
+	for (int i = 0; i < NUM_CAPABILITIES; i++)
+		s_capabilityEnabled[i] = UNKNOWN;
+	s_blendSource = UNKNOWN;
+	s_blendDestination = UNKNOWN;
+	s_depthMask = UNKNOWN;
+}
+
+const GLStateCounters& CGLStateCache::GetCounters()
+{
+	return s_counters;
+}
+
+void CGLStateCache::ResetCounters()
+{
+	s_counters = GLStateCounters();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Common.h"
+
+// Kinds of state call the cache tracks, for the issued / skipped counters
+enum GLStateCall
+{
+	STATE_CALL_PROGRAM,
+	STATE_CALL_VERTEX_ARRAY,
+	STATE_CALL_ACTIVE_TEXTURE,
+	STATE_CALL_TEXTURE,
+	STATE_CALL_SAMPLER,
+	STATE_CALL_CAPABILITY,		// glEnable / glDisable
+	STATE_CALL_BLEND_FUNC,
+	STATE_CALL_DEPTH_MASK,
+	NUM_STATE_CALLS
+};
+
+// How many calls of each kind reached OpenGL and how many were dropped because they would not have changed anything
+struct GLStateCounters
+{
+	int issued[NUM_STATE_CALLS];
+	int skipped[NUM_STATE_CALLS];
+
+	GLStateCounters();
+	int GetTotalIssued() const;
+	int GetTotalSkipped() const;
+};
+
+// Shadows the OpenGL binding and render state that the game changes while drawing, and only passes a call on when it
+// changes something.  Every bind, enable / disable, blend function and depth mask change in the game goes through here,
+// so the shadow copy stays right; code that changes the state directly must call Invalidate afterwards.  Everything
+// starts out unknown, so the first call of each kind is always issued.  All calls must come from the thread that owns
+// the GL context.
+class CGLStateCache
+{
+public:
+	static const int MAX_TEXTURE_UNITS = 16;
+
+	static void UseProgram(GLuint program);
+	static void BindVertexArray(GLuint vao);
+	static void BindTexture(GLuint unit, GLenum target, GLuint texture);	// GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_BUFFER
+	static void BindSampler(GLuint unit, GLuint sampler);
+	static void Enable(GLenum capability);								// GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE are cached
+	static void Disable(GLenum capability);
+	static void BlendFunc(GLenum source, GLenum destination);
+	static void DepthMask(bool write);
+
+	// Deleting an object unbinds it, and OpenGL may hand its name out again, so deletes go through here too
+	static void DeleteProgram(GLuint program);
+	static void DeleteVertexArray(GLuint vao);
+	static void DeleteTexture(GLuint texture);
+	static void DeleteSampler(GLuint sampler);
+
+	static void Invalidate();											// Forget everything, e.g. after a new context is made current
+
+	static const GLStateCounters& GetCounters();						// Since the last ResetCounters
+	static void ResetCounters();
+
+private:
+	static void SetCapability(GLenum capability, bool enabled);
+	static void ActiveTexture(GLuint unit);
+};
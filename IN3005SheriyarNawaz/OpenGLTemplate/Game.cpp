@@ -34,8 +34,71 @@ Source code drawn from a number of sources and examples, including contributions
 #include "OpenAssetImportMesh.h"
 #include "Audio.h"
 #include "CatmullRom.h"
+#include "TrackMesh.h"
+#include "TrackPlacements.h"
 #include "Coin.h"
 #include "Tyre.h"
+#include "InstanceBuffer.h"
+#include "UniformBuffer.h"
+#include "LightClusters.h"
+#include "Frustum.h"
+#include "TrackBroadphase.h"
+#include "CollectibleSet.h"
+#include "RaceSimulation.h"
+#include "Profiler.h"
+#include "GpuTimer.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "GeometryArena.h"
+
+// Materials and meshes as they are numbered in render queue keys
+enum SceneMaterial
+{
+	MATERIAL_GROUND,
+	MATERIAL_CAR,
+	MATERIAL_COIN,
+	MATERIAL_TYRE,
+	MATERIAL_LIGHT_POST,
+	MATERIAL_TRACK
+};
+
+enum SceneMesh
+{
+	MESH_SKYBOX,
+	MESH_TERRAIN,
+	MESH_CAR,
+	MESH_COIN,
+	MESH_TYRE,
+	MESH_LIGHT_POST,
+	MESH_TRACK
+};
+
+// Draw calls for the render queue
+static void DrawSkybox(void* pObject, void*) { ((CSkybox*)pObject)->Render(); }
+static void DrawPlane(void* pObject, void*) { ((CPlane*)pObject)->Render(); }
+static void DrawMesh(void* pObject, void*) { ((COpenAssetImportMesh*)pObject)->Render(); }
+static void DrawMeshInstanced(void* pObject, void* pArgument) { ((COpenAssetImportMesh*)pObject)->RenderInstanced((CInstanceBuffer*)pArgument); }
+static void DrawCoins(void* pObject, void* pArgument) { ((CCoin*)pObject)->RenderInstanced((CInstanceBuffer*)pArgument); }
+static void DrawTyres(void* pObject, void* pArgument) { ((CTyre*)pObject)->RenderInstanced((CInstanceBuffer*)pArgument); }
+static void DrawTrack(void* pObject, void*) { ((CTrackMesh*)pObject)->RenderSelectedChunks(); }
+
+// The driving keys are read by the simulation thread before it steps, rather than from the window messages on the
+// render thread, so a slow frame does not hold up the controls.  Letting go of W slows the car down
+static unsigned int ReadRaceInputs()
+{
+	unsigned int inputs = 0;
+	if (GetAsyncKeyState('W') & 0x8000)
+		inputs |= INPUT_ACCELERATE;
+	else
+		inputs |= INPUT_DECELERATE;
+	if (GetAsyncKeyState('S') & 0x8000)
+		inputs |= INPUT_BRAKE;
+	if (GetAsyncKeyState('A') & 0x8000)
+		inputs |= INPUT_TURN_LEFT;
+	else if (GetAsyncKeyState('D') & 0x8000)
+		inputs |= INPUT_TURN_RIGHT;
+	return inputs;
+}
 
 // Constructor
 Game::Game()
@@ -48,14 +111,41 @@ Game::Game()
 	m_pHighResolutionTimer = NULL;
 	m_pAudio = NULL;
 	m_pCatmullRom = NULL;
+	m_pTrackMesh = NULL;
 	m_pCarMesh = NULL;
 	m_pLightMesh = NULL;
 	m_pCoin = NULL;
 	m_pTyre = NULL;
-
-	m_carPosition = glm::vec3(15, 1, 100);
+	m_pCarRenderCursor = NULL;
+	m_pCoinInstances = NULL;
+	m_pTyreInstances = NULL;
+	m_pLightInstances = NULL;
+	m_pCameraBlock = NULL;
+	m_pLightBlock = NULL;
+	m_pLightData = NULL;
+	m_pLightClusters = NULL;
+	m_pFrustum = NULL;
+	m_pCoinTree = NULL;
+	m_pTyreTree = NULL;
+	m_pLightTree = NULL;
+	m_pCullStats = NULL;
+	m_pCoinBroadphase = NULL;
+	m_pTyreBroadphase = NULL;
+	m_pCoins = NULL;
+	m_pTyres = NULL;
+	m_pRaceSimulation = NULL;
+	m_pGpuTimer = NULL;
+	m_pRenderQueue = NULL;
+
+	m_carRenderPosition = glm::vec3(15, 1, 100);
 	m_dt = 0.0;
+	m_gameTime = 0.0;
 	m_framesPerSecond = 0;
+	m_uncachedUniformLookups = 0;
+	m_missingUniformLookups = 0;
+	m_stateCallsIssued = 0;
+	m_stateCallsSkipped = 0;
+	m_showGpuTimes = false;
 	m_frameCount = 0;
 	m_elapsedTime = 0.0f;
 	m_freeLook = false;
@@ -63,41 +153,19 @@ Game::Game()
 	m_firstPerson = false;
 	m_thirdPerson = true;
 
-	m_turnRight = false;
-	m_turnLeft = false;
-	m_accelerating = false;
-	m_decelerating = false;
-	m_breaking = false;
-
-	m_carSpeed = 0.0f;
-	m_carRotation = 0.0f;
-	m_maxSpeed = 100.0f;
-	m_acceleration = 10;
-	m_deceleration = 20;
-	m_turnSpeed = 0.75f;
-	m_breakSpeed = 50;
-
-	m_currentDistance = 0.0f;
-	m_sidePosition = 0.0f;
-	m_furthestSidePosition = 0.8f;
-
-	m_collisionCooldown = 0.0f;
-	m_score = 0;
-	m_lives = 5;
-	m_gameOver = false;
+
+	m_carRenderRotation = 0.0f;
 
 	m_lightsFlickering = true;
 	m_lightFlickerRate = 2.0f;
-
-	m_cameraShaking = false;
-	m_shakeTime = 0.0f;
-	m_shakeDuration = 0.5f;
-	m_shakeIntensity = 0.5f;
 }
 
 // Destructor
 Game::~Game()
 {
+	// Stop the race thread before anything it uses goes away
+	delete m_pRaceSimulation;
+
 	//game objects
 	delete m_pCamera;
 	delete m_pSkybox;
@@ -105,10 +173,30 @@ Game::~Game()
 	delete m_pFtFont;
 	delete m_pAudio;
 	delete m_pCatmullRom;
+	delete m_pTrackMesh;
 	delete m_pCarMesh;
 	delete m_pLightMesh;
 	delete m_pCoin;
 	delete m_pTyre;
+	delete m_pCarRenderCursor;
+	delete m_pCoinInstances;
+	delete m_pTyreInstances;
+	delete m_pLightInstances;
+	delete m_pCameraBlock;
+	delete m_pLightBlock;
+	delete m_pLightData;
+	delete m_pLightClusters;
+	delete m_pFrustum;
+	delete m_pCoinTree;
+	delete m_pTyreTree;
+	delete m_pLightTree;
+	delete m_pCullStats;
+	delete m_pCoinBroadphase;
+	delete m_pTyreBroadphase;
+	delete m_pCoins;
+	delete m_pTyres;
+	delete m_pGpuTimer;
+	delete m_pRenderQueue;
 
 	if (m_pShaderPrograms != NULL) {
 		for (unsigned int i = 0; i < m_pShaderPrograms->size(); i++)
@@ -135,10 +223,31 @@ void Game::Initialise()
 	m_pFtFont = new CFreeTypeFont;
 	m_pAudio = new CAudio;
 	m_pCatmullRom = new CCatmullRom;
+	m_pTrackMesh = new CTrackMesh;
 	m_pCarMesh = new COpenAssetImportMesh;
 	m_pLightMesh = new COpenAssetImportMesh;
 	m_pCoin = new CCoin;
 	m_pTyre = new CTyre;
+	m_pCarRenderCursor = new SplineCursor;
+	m_pCoinInstances = new CInstanceBuffer;
+	m_pTyreInstances = new CInstanceBuffer;
+	m_pLightInstances = new CInstanceBuffer;
+	m_pCameraBlock = new CUniformBuffer;
+	m_pLightBlock = new CUniformBuffer;
+	m_pLightData = new LightBlock();
+	m_pLightClusters = new CLightClusters;
+	m_pFrustum = new CFrustum;
+	m_pCoinTree = new CBoundingSphereTree;
+	m_pTyreTree = new CBoundingSphereTree;
+	m_pLightTree = new CBoundingSphereTree;
+	m_pCullStats = new CullStats;
+	m_pCoinBroadphase = new CTrackBroadphase;
+	m_pTyreBroadphase = new CTrackBroadphase;
+	m_pCoins = new CCollectibleSet;
+	m_pTyres = new CCollectibleSet;
+	m_pRaceSimulation = new CRaceSimulation;
+	m_pGpuTimer = new CGpuTimer;
+	m_pRenderQueue = new CRenderQueue;
 
 	RECT dimensions = m_gameWindow.GetDimensions();
 
@@ -178,6 +287,15 @@ void Game::Initialise()
 	pMainProgram->LinkProgram();
 	m_pShaderPrograms->push_back(pMainProgram);
 
+	// Camera matrices and lights live in uniform buffers that any program can share by binding the same blocks
+	m_pCameraBlock->Create(sizeof(CameraBlock), CAMERA_BLOCK_BINDING);
+	m_pLightBlock->Create(sizeof(LightBlock), LIGHT_BLOCK_BINDING);
+	pMainProgram->BindUniformBlock("CameraBlock", CAMERA_BLOCK_BINDING);
+	pMainProgram->BindUniformBlock("LightBlock", LIGHT_BLOCK_BINDING);
+
+	// Track lights are binned into 64x64 pixel tiles with 24 depth slices between the near and far planes
+	m_pLightClusters->Create(width, height, 64, 24, 0.5f, 5000.0f);
+
 	// Create a shader program for fonts
 	CShaderProgram* pFontProgram = new CShaderProgram;
 	pFontProgram->CreateProgram();
@@ -204,20 +322,62 @@ void Game::Initialise()
 	m_pCoin->Create("resources\\textures\\", "gold.png", 20, 0.5f); //Texture from https://freepbr.com/product/hammered-gold-pbr/
 	m_pTyre->Create("resources\\textures\\", "tyre.png", 32, 24, 1.0f, 0.3f); // Texture from https://freepbr.com/product/textured-rubber-pbr-material/
 
-	glEnable(GL_CULL_FACE);
+	CGLStateCache::Enable(GL_CULL_FACE);
 
 	m_pCatmullRom->CreateCentreline();
 	m_pCatmullRom->CreateOffsetCurves();
-	m_pCatmullRom->CreateTrack("resources\\textures\\", "road.jpg"); // Texture from https://uk.pinterest.com/pin/156781630764428267/ 
+	m_pTrackMesh->Create(m_pCatmullRom, "resources\\textures\\", "road.jpg"); // Texture from https://uk.pinterest.com/pin/156781630764428267/ 
+
+	BakeTrackPlacements();
+
+	m_pGpuTimer->Create();
+
+	// Everything in the scene is drawn with the main program through the render queue
+	m_pRenderQueue->Create(m_pShaderPrograms, m_pGpuTimer);
+	m_pRenderQueue->SetMaterial(MATERIAL_GROUND, RenderMaterial(glm::vec3(0.35f), glm::vec3(0.4f), glm::vec3(1.0f), 30.0f));	// Higher ambient material reflectance
+	m_pRenderQueue->SetMaterial(MATERIAL_CAR, RenderMaterial(glm::vec3(0.8f), glm::vec3(0.9f), glm::vec3(1.0f), 25.0f));
+	m_pRenderQueue->SetMaterial(MATERIAL_TYRE, RenderMaterial(glm::vec3(0.2f), glm::vec3(0.6f), glm::vec3(0.4f), 10.0f));
+	m_pRenderQueue->SetMaterial(MATERIAL_LIGHT_POST, RenderMaterial(glm::vec3(0.8f), glm::vec3(0.8f), glm::vec3(1.0f), 40.0f));
+	m_pRenderQueue->SetMaterial(MATERIAL_TRACK, RenderMaterial(glm::vec3(0.8f), glm::vec3(0.8f), glm::vec3(1.0f), 40.0f));	// Drawn last, the track always picked up the light posts' material
+
+	// Give coins a gold tint, and spin and wobble them
+	RenderMaterial gold(glm::vec3(0.7f, 0.6f, 0.2f), glm::vec3(1.0f, 0.8f, 0.2f), glm::vec3(1.0f, 0.9f, 0.6f), 120.0f);
+	gold.spinSpeed = 250.0f;
+	gold.wobbleAmount = 10.0f;
+	gold.wobbleSpeed = 3.0f;
+	m_pRenderQueue->SetMaterial(MATERIAL_COIN, gold);
+
+	// The race runs on its own thread from here on, and owns the coins and tyres
+	m_pRaceSimulation->Create(m_pCatmullRom, m_pCoins, m_pCoinBroadphase, m_pTyres, m_pTyreBroadphase, m_pAudio);
+	m_pRaceSimulation->SetInputSource(ReadRaceInputs);
 }
 
 // Render method runs repeatedly in a loop
 void Game::Render()
 {
+	PROFILE_ZONE("Game::Render");
+
+	// Count the uniforms set by name rather than by handle during the last frame, and the names that weren't found
+	m_uncachedUniformLookups = 0;
+	m_missingUniformLookups = 0;
+	for (unsigned int i = 0; i < m_pShaderPrograms->size(); i++) {
+		m_uncachedUniformLookups += (*m_pShaderPrograms)[i]->GetUncachedLookupCount();
+		m_missingUniformLookups += (*m_pShaderPrograms)[i]->GetMissingLookupCount();
+		(*m_pShaderPrograms)[i]->ResetUncachedLookupCount();
+	}
+
+	// Likewise the state changes the GL state cache passed on and dropped
+	m_stateCallsIssued = CGLStateCache::GetCounters().GetTotalIssued();
+	m_stateCallsSkipped = CGLStateCache::GetCounters().GetTotalSkipped();
+	CGLStateCache::ResetCounters();
+
+	// Passes are timed on the GPU from here until just before the buffers are swapped
+	m_pGpuTimer->BeginFrame();
 
-	// Clear the buffers and enable depth testing (z-buffering)
+	// Clear the buffers and enable depth testing (z-buffering).  The HUD leaves blending on, so turn it off for the scene
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_DEPTH_TEST);
+	CGLStateCache::Enable(GL_DEPTH_TEST);
+	CGLStateCache::Disable(GL_BLEND);
 
 	// Set up a matrix stack
 	glutil::MatrixStack modelViewMatrixStack;
@@ -226,571 +386,407 @@ void Game::Render()
 	// Use the main shader program 
 	CShaderProgram* pMainProgram = (*m_pShaderPrograms)[0];
 	pMainProgram->UseProgram();
-	pMainProgram->SetUniform("bUseTexture", true);
 	pMainProgram->SetUniform("sampler0", 0);
 	pMainProgram->SetUniform("CubeMapTex", 1);
-
-
-	// Set the projection matrix
-	pMainProgram->SetUniform("matrices.projMatrix", m_pCamera->GetPerspectiveProjectionMatrix());
+	pMainProgram->SetUniform("lightData", LIGHT_DATA_TEXTURE_UNIT);
+	pMainProgram->SetUniform("clusterGrid", CLUSTER_GRID_TEXTURE_UNIT);
+	pMainProgram->SetUniform("lightIndices", LIGHT_INDEX_TEXTURE_UNIT);
 
 	// Call LookAt to create the view matrix and put this on the modelViewMatrix stack. 
 	// Store the view matrix and the normal matrix associated with the view matrix for later (they're useful for lighting -- since lighting is done in eye coordinates)
 	modelViewMatrixStack.LookAt(m_pCamera->GetPosition(), m_pCamera->GetView(), m_pCamera->GetUpVector());
 	glm::mat4 viewMatrix = modelViewMatrixStack.Top();
-	glm::mat3 viewNormalMatrix = m_pCamera->ComputeNormalMatrix(viewMatrix);
-	glm::vec4 lightPosition1 = glm::vec4(-100, 100, -100, 1); // Position of light source *in world coordinates*
-	pMainProgram->SetUniform("light1.position", viewMatrix * lightPosition1); // Position of light source *in eye coordinates*
-	pMainProgram->SetUniform("light1.La", glm::vec3(0.06f, 0.06f, 0.08f));  // Increased ambient light for better visibility
-	pMainProgram->SetUniform("light1.Ld", glm::vec3(0.0f));                 // No diffuse light
-	pMainProgram->SetUniform("light1.Ls", glm::vec3(0.0f));                 // No specular
-	pMainProgram->SetUniform("light1.direction", glm::vec3(0.0f, -1.0f, 0.0f));
-	pMainProgram->SetUniform("light1.exponent", 1.0f);
-	pMainProgram->SetUniform("light1.cutoff", 180.0f);
-
-	// Set material properties for better ambient reflection
-	pMainProgram->SetUniform("material1.Ma", glm::vec3(0.35f));       // Higher ambient material reflectance
-	pMainProgram->SetUniform("material1.Md", glm::vec3(0.4f));
-	pMainProgram->SetUniform("material1.Ms", glm::vec3(1.0f));
-	pMainProgram->SetUniform("material1.shininess", 30.0f);
-	pMainProgram->SetUniform("numActiveLights", 16);
-
-
-	// Render the skybox and terrain with full ambient reflectance 
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("renderSkybox", true);
-	// Translate the modelview matrix to the camera eye point so skybox stays centred around camera
+
+	// Upload the projection and view matrices for this frame in one go
+	CameraBlock cameraBlock;
+	cameraBlock.projMatrix = *m_pCamera->GetPerspectiveProjectionMatrix();
+	cameraBlock.viewMatrix = viewMatrix;
+	m_pCameraBlock->Update(&cameraBlock, sizeof(cameraBlock));
+
+	// Everything below is tested against the view frustum
+	m_pFrustum->Update(cameraBlock.projMatrix, viewMatrix);
+	*m_pCullStats = CullStats();
+
+	// Upload all lights and their clusters before anything is drawn
+	UpdateLightBlock(viewMatrix);
+	m_pLightClusters->Bind();
+
+	// Every instanced draw this frame animates from the same clock
+	pMainProgram->SetUniform("animation.time", (float)(m_gameTime / 1000.0));
+
+	// Queue the scene, then draw it sorted by program, material and mesh
 	glm::vec3 vEye = m_pCamera->GetPosition();
-	modelViewMatrixStack.Translate(vEye);
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pSkybox->Render();
-	pMainProgram->SetUniform("renderSkybox", false);
-	modelViewMatrixStack.Pop();
 
-	// Render the planar terrain
+	// Render the skybox.  Translate the modelview matrix to the camera eye point so skybox stays centred around camera
 	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pPlanarTerrain->Render();
+	modelViewMatrixStack.Translate(vEye);
+	RenderPacket sky;
+	sky.key = CRenderQueue::MakeKey(RENDER_PASS_SKY, 0, MATERIAL_GROUND, MESH_SKYBOX, 0.0f);
+	sky.draw = DrawSkybox;
+	sky.pObject = m_pSkybox;
+	sky.modelViewMatrix = modelViewMatrixStack.Top();
+	sky.skybox = true;
+	sky.gpuPass = GPU_PASS_SKYBOX;
+	m_pRenderQueue->Submit(sky);
 	modelViewMatrixStack.Pop();
 
-
-	pMainProgram->SetUniform("material1.Ma", glm::vec3(0.8f));
-	pMainProgram->SetUniform("material1.Md", glm::vec3(0.9f));
-	pMainProgram->SetUniform("material1.Ms", glm::vec3(1.0f));
-	pMainProgram->SetUniform("material1.shininess", 25.0f);
+	// Render the planar terrain.  It is tested as a flat box, since a sphere round it would always contain the camera
+	BoundingBox terrainBounds(glm::vec3(-1000.0f, 0.0f, -1000.0f), glm::vec3(1000.0f, 0.0f, 1000.0f));
+	if (m_pFrustum->IsBoxVisible(terrainBounds)) {
+		RenderPacket terrain;
+		terrain.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_GROUND, MESH_TERRAIN,
+			CRenderQueue::GetViewDepth(vEye, glm::vec3(0.0f), glm::length(terrainBounds.max)));
+		terrain.draw = DrawPlane;
+		terrain.pObject = m_pPlanarTerrain;
+		terrain.modelViewMatrix = modelViewMatrixStack.Top();
+		terrain.gpuPass = GPU_PASS_TERRAIN;
+		m_pRenderQueue->Submit(terrain);
+		m_pCullStats->visible++;
+	}
+	else
+		m_pCullStats->culled++;
 
 	//Render Car
 	modelViewMatrixStack.Push();
-	modelViewMatrixStack.Translate(m_carPosition);
-	modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), m_carRotation);
+	modelViewMatrixStack.Translate(m_carRenderPosition);
+	modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), m_carRenderRotation);
 	modelViewMatrixStack.RotateX(glm::radians(-90.0f));
 	modelViewMatrixStack.Scale(3, 3, 3);
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pCarMesh->Render();
+	RenderPacket car;
+	car.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_CAR, MESH_CAR,
+		CRenderQueue::GetViewDepth(vEye, m_carRenderPosition, m_pCarMesh->GetBoundingRadius() * 3.0f));
+	car.draw = DrawMesh;
+	car.pObject = m_pCarMesh;
+	car.modelViewMatrix = modelViewMatrixStack.Top();
+	car.gpuPass = GPU_PASS_CAR;
+	m_pRenderQueue->Submit(car);
 	modelViewMatrixStack.Pop();
 
 	RenderCoinsAlongTrack();
 	RenderTyresAlongTrack();
 	RenderLightMeshesAlongTrack();
 
-	//Render Track
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("bUseTexture", true);
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pCatmullRom->RenderTrack();
-	modelViewMatrixStack.Pop();
+	//Render Track.  The chunks are chosen now and drawn when the queue runs
+	m_pTrackMesh->SelectTrackChunks(vEye, m_pFrustum, m_pCullStats);
+	if (m_pTrackMesh->GetTrackTriangles() > 0) {
+		RenderPacket track;
+		track.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_TRACK, MESH_TRACK, 0.0f);
+		track.draw = DrawTrack;
+		track.pObject = m_pTrackMesh;
+		track.modelViewMatrix = modelViewMatrixStack.Top();
+		track.gpuPass = GPU_PASS_TRACK;
+		m_pRenderQueue->Submit(track);
+	}
+
+	m_pRenderQueue->Execute();
 
 	// Draw the 2D graphics after the 3D graphics
+	m_pGpuTimer->BeginPass(GPU_PASS_HUD);
 	DisplayFrameRate();
+	m_pGpuTimer->EndPass(GPU_PASS_HUD);
+
+	m_pGpuTimer->EndFrame();
 
-	// Swap buffers to show the rendered image
-	SwapBuffers(m_gameWindow.Hdc());
+	// Swap buffers to show the rendered image.  This is where the driver waits if the GPU is behind
+	{
+		PROFILE_ZONE("SwapBuffers");
+		SwapBuffers(m_gameWindow.Hdc());
+	}
 
 }
 
 void Game::Update()
 {
-	//Player inputs change booleans that correspond to a state of what kind of movement the car is performing
-	if (m_accelerating && !m_breaking) {
-		m_carSpeed += m_acceleration * (m_dt / 1000.0f); //Accelerate
-		if (m_carSpeed > m_maxSpeed)
-			m_carSpeed = m_maxSpeed;
-	}
-	else if (m_decelerating && !m_breaking) {
-		m_carSpeed -= m_deceleration * (m_dt / 1000.0f); //Slow down at a different rate when decelerating
-		if (m_carSpeed < 0.0f)
-			m_carSpeed = 0.0f;
-	}
-	else if (m_breaking) {
-		m_carSpeed -= m_breakSpeed * (m_dt / 1000.0f); //Slow down when breaking
-		if (m_carSpeed < 0.0f)
-			m_carSpeed = 0.0f;
-	}
-
-	m_currentDistance += m_carSpeed * (m_dt / 1000.0f); //Update cars distance along the spline using speed of the car
-
-	//Turn left or right using turn speed
-	if (m_turnLeft) {
-		m_sidePosition -= m_turnSpeed * (m_dt / 1000.0f);
-	}
-	else if (m_turnRight) {
-		m_sidePosition += m_turnSpeed * (m_dt / 1000.0f);
-	}
-
-	//Confine the cars side to side position within the track
-	if (m_sidePosition < -m_furthestSidePosition)
-		m_sidePosition = -m_furthestSidePosition;
-	if (m_sidePosition > m_furthestSidePosition)
-		m_sidePosition = m_furthestSidePosition;
-
-	//Get position on track
-	glm::vec3 centrelinePos;
-	m_pCatmullRom->Sample(m_currentDistance, centrelinePos);
-
-	//Get position slightly ahead of track
-	glm::vec3 nextPos;
-	m_pCatmullRom->Sample(m_currentDistance + 0.1f, nextPos);
-
-	glm::vec3 T = glm::normalize(nextPos - centrelinePos); //Calculate tangent vector along track
-	glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
-	glm::vec3 N = glm::normalize(glm::cross(T, worldUp)); //Calculate normal vector perpendicular to track
-
-	glm::vec3 B = glm::normalize(glm::cross(N, T)); //Calculate biniormal vector
-
-	float trackWidth = 50.0f;
-	m_carPosition = centrelinePos + N * (trackWidth * 0.5f * m_sidePosition);
-	m_carPosition.y = centrelinePos.y + 0.5f;
+	PROFILE_ZONE("Game::Update");
+	// Animations move on with the frame time, but jump no more than MAX_FRAME_TIME after a stall
+	m_gameTime += glm::min(m_dt, (double)MAX_FRAME_TIME);
+
+	// Pick up the latest race state from the simulation thread, if there is a new one.  Until there is, the last
+	// snapshot is drawn again
+	m_pRaceSimulation->AcquireSnapshot();
+	const RaceSnapshot& snapshot = m_pRaceSimulation->GetSnapshot();
+
+	// Draw the car between the last two steps.  The snapshot is at most one step old, so drawing it as it was one step
+	// before now keeps the car moving smoothly whichever step it is on
+	float alpha = (float)((m_pRaceSimulation->GetTime() - snapshot.time) / CRaceSimulation::GetStepLength());
+	alpha = glm::clamp(alpha, 0.0f, 1.0f);
+	float distance = glm::mix(snapshot.previous.distance, snapshot.current.distance, alpha);
+	float sidePosition = glm::mix(snapshot.previous.sidePosition, snapshot.current.sidePosition, alpha);
+
+	SplineFrame frame;
+	m_pCatmullRom->SampleFrame(distance, *m_pCarRenderCursor, frame);
+	m_carRenderPosition = CRaceSimulation::ComputeCarPosition(frame, sidePosition);
 
 	//Rotate car to face the right way on the track
-	m_carRotation = atan2(-T.x, -T.z);
-
-	HandleCameraAngles(T, B);
-	HandleCameraShake(T, B);
-
-	if (!m_gameOver) {
-		CheckCollision();
-	}
-
-	if (m_lives <= 0) {
-		m_gameOver = true;
-	}
-
-	if (m_collisionCooldown > 0.0f) { //Reduce collision cooldown to 0 to allow for collisions with a tyre after another time. i.e. invulnerability period when hitting tyre
-		m_collisionCooldown -= m_dt / 1000.0f;
-	}
+	m_carRenderRotation = atan2(-frame.T.x, -frame.T.z);
 
-	m_pAudio->Update();
+	HandleCameraAngles(frame.T, frame.B, snapshot.shakeOffset);
 }
 
-void Game::HandleCameraAngles(glm::vec3& T, glm::vec3& B)
+// Places the camera for the current view.  The shake offset from the simulation is zero unless the car has just hit a tyre
+void Game::HandleCameraAngles(glm::vec3& T, glm::vec3& B, const glm::vec3& shakeOffset)
 {
 	if (m_thirdPerson) {
 		glm::vec3 cameraOffset = -25.0f * T + glm::vec3(0.0f, 8.0f, 0.0f);
-		glm::vec3 cameraPos = m_carPosition + cameraOffset;
-		m_pCamera->Set(cameraPos, m_carPosition, glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::vec3 cameraPos = m_carRenderPosition + cameraOffset + shakeOffset;
+		m_pCamera->Set(cameraPos, m_carRenderPosition, glm::vec3(0.0f, 1.0f, 0.0f));
 	}
 	else if (m_firstPerson) {
-		glm::vec3 cameraPos = m_carPosition + B * 2.0f;
-		glm::vec3 lookAt = m_carPosition + 20.0f * T;
+		glm::vec3 cameraPos = m_carRenderPosition + B * 2.0f + shakeOffset;
+		glm::vec3 lookAt = m_carRenderPosition + 20.0f * T;
 		m_pCamera->Set(cameraPos, lookAt, B);
 	}
 	else if (m_topView) {
-		glm::vec3 cameraPos = m_carPosition + glm::vec3(0.0f, 60.0f, 0.0f);
-		m_pCamera->Set(cameraPos, m_carPosition, -T);
+		glm::vec3 cameraPos = m_carRenderPosition + glm::vec3(0.0f, 60.0f, 0.0f) + shakeOffset;
+		m_pCamera->Set(cameraPos, m_carRenderPosition, -T);
 	}
 	else if (m_freeLook) {
 		m_pCamera->Update(m_dt);
 	}
 }
 
-void Game::HandleCameraShake(glm::vec3& T, glm::vec3& B)
-{
-	if (m_cameraShaking) {
-		m_shakeTime += m_dt / 1000.0f; //Begin timer for how long camera shakes
-
-		if (m_shakeTime < m_shakeDuration) {
-			if (!m_freeLook) {
-				//Apply a shake factor with a random offset on every angle
-				float shakeFactor = m_shakeIntensity * (1.0f - (m_shakeTime / m_shakeDuration));
-
-				float offsetX = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * shakeFactor;
-				float offsetY = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * shakeFactor;
-				float offsetZ = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * shakeFactor;
-
-				glm::vec3 shakeOffset = glm::vec3(offsetX, offsetY, offsetZ);
-
-				//Apply the shake effect
-				if (m_thirdPerson) {
-					glm::vec3 cameraOffset = -25.0f * T + glm::vec3(0.0f, 8.0f, 0.0f);
-					glm::vec3 cameraPos = m_carPosition + cameraOffset + shakeOffset;
-					m_pCamera->Set(cameraPos, m_carPosition, glm::vec3(0.0f, 1.0f, 0.0f));
-				}
-				else if (m_firstPerson) {
-					glm::vec3 cameraPos = m_carPosition + B * 2.0f + shakeOffset;
-					glm::vec3 lookAt = m_carPosition + 20.0f * T;
-					m_pCamera->Set(cameraPos, lookAt, B);
-				}
-				else if (m_topView) {
-					glm::vec3 cameraPos = m_carPosition + glm::vec3(0.0f, 60.0f, 0.0f) + shakeOffset;
-					m_pCamera->Set(cameraPos, m_carPosition, -T);
-				}
-			}
-		}
-		else {
-			m_cameraShaking = false;
-		}
-	}
-}
-
-void Game::CheckCollision()
+// Positions of coins, tyres and lights depend only on the track, so work them out once after the track is built.
+// Rendering then only has to apply the per-frame spin, wobble and flicker on top of these transforms
+void Game::BakeTrackPlacements()
 {
-	float collisionDistance = 15.0f;
-
-	for (size_t i = 0; i < m_coinPositions.size(); i++) {
-		if (!m_coinCollected[i]) {
-			float distance = glm::distance(m_carPosition, m_coinPositions[i]);
-			//If the distance between car and a coin is within a range, use that as a collision. Mark the coin as collected and increase score 
+	CTrackPlacements placements;
+	placements.Create(m_pCatmullRom);
+	float trackLength = m_pCatmullRom->GetTrackLength();
 
-			if (distance < collisionDistance) {
-				m_coinCollected[i] = true;
-				m_score += 100;
-			}
-		}
-	}
+	// Coins
+	const vector<TrackPlacement>& coins = placements.GetCoins();
+	CTrackPlacements::LoadCollectibles(coins, trackLength, m_pCoins, m_pCoinBroadphase);
 
-	float tyreCollisionDistance = 15.0f;
-	for (size_t i = 0; i < m_tyrePositions.size(); i++) {
-		float distance = glm::distance(m_carPosition, m_tyrePositions[i]);
-		//If the distance between car and a tyre is within a range, use that as a collision. Begin a timer to prevent lives instantly going down to 0 
+	vector<glm::mat4> coinTransforms;
+	vector<BoundingSphere> coinSpheres;
+	for (size_t i = 0; i < coins.size(); i++) {
+		glutil::MatrixStack transform;
+		transform.SetIdentity();
+		transform.Translate(coins[i].position);
+		coinTransforms.push_back(transform.Top());
 
-		if (distance < tyreCollisionDistance && m_collisionCooldown <= 0.0f) {
-			m_lives -= 1;
-			m_collisionCooldown = 1.0f;
-			m_cameraShaking = true;
-			m_shakeTime = 0.0f;
-		}
+		// Bounding spheres for culling, in the same order as the instances.  Coins have radius 1
+		coinSpheres.push_back(BoundingSphere(coins[i].position, 1.1f));
 	}
-}
-
-void Game::RenderCoinsAlongTrack()
-{
-	CShaderProgram* pMainProgram = (*m_pShaderPrograms)[0];
+	m_pCoinInstances->Create(coinTransforms);
+	m_pCoinTree->Build(coinSpheres);
 
-	glutil::MatrixStack modelViewMatrixStack;
-	modelViewMatrixStack.SetIdentity();
+	// Tyres
+	const vector<TrackPlacement>& tyres = placements.GetTyres();
+	CTrackPlacements::LoadCollectibles(tyres, trackLength, m_pTyres, m_pTyreBroadphase);
 
-	modelViewMatrixStack.LookAt(m_pCamera->GetPosition(), m_pCamera->GetView(), m_pCamera->GetUpVector());
+	vector<glm::mat4> tyreTransforms;
+	vector<BoundingSphere> tyreSpheres;
+	for (size_t i = 0; i < tyres.size(); i++) {
+		glutil::MatrixStack transform;
+		transform.SetIdentity();
+		transform.Translate(tyres[i].position);
 
-	// Give coins a gold tint
-	pMainProgram->SetUniform("material1.Ma", glm::vec3(0.7f, 0.6f, 0.2f));
-	pMainProgram->SetUniform("material1.Md", glm::vec3(1.0f, 0.8f, 0.2f));
-	pMainProgram->SetUniform("material1.Ms", glm::vec3(1.0f, 0.9f, 0.6f));
-	pMainProgram->SetUniform("material1.shininess", 120.0f);
+		// Rotate the tyre to face the track direction
+		float yaw = atan2(-tyres[i].direction.x, -tyres[i].direction.z);
+		transform.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), yaw);
 
-	float trackLength = m_pCatmullRom->GetTrackLength();
-	float coinSpacing = 15.0f;
-	int numCoins = static_cast<int>(trackLength / coinSpacing);
+		transform.Rotate(glm::vec3(0.0f, 0.0f, 1.0f), glm::radians(5.0f));
 
-	float maxLateralOffset = 0.7f;
-	float trackWidth = 50.0f;
+		transform.Scale(6.0f, 6.0f, 6.0f);
+		tyreTransforms.push_back(transform.Top());
 
-	// Initialize the coin positions. Used for collision detection
-	if (m_coinPositions.empty()) {
-		m_coinPositions.resize(numCoins);
-		m_coinCollected.resize(numCoins, false);
+		// Tyre torus: (main radius + tube radius) * scale
+		tyreSpheres.push_back(BoundingSphere(tyres[i].position, (1.0f + 0.3f) * 6.0f));
 	}
+	m_pTyreInstances->Create(tyreTransforms);
+	m_pTyreTree->Build(tyreSpheres);
 
-	for (int i = 0; i < numCoins; i++) {
-		//Don't render coin if its collected
-		if (m_coinCollected.size() > i && m_coinCollected[i]) {
-			continue;
-		}
+	// Lights
+	const vector<TrackPlacement>& lights = placements.GetLights();
 
-		float distance = i * coinSpacing;
-		glm::vec3 coinPosition;
-		glm::vec3 up;
+	vector<glm::mat4> lightTransforms;
+	vector<BoundingSphere> lightSpheres;
+	m_lightPositions.clear();
+	m_lightDirections.clear();
+	m_lightColours.clear();
 
-		if (m_pCatmullRom->Sample(distance, coinPosition, up)) {
+	for (size_t i = 0; i < lights.size(); i++) {
+		glutil::MatrixStack transform;
+		transform.SetIdentity();
+		transform.Translate(lights[i].position);
 
-			//Apply a zigzag spread to the coins using sin
-			float zigzagFactor = sin(i * 0.5f);
-			float lateralOffset = maxLateralOffset * zigzagFactor;
+		// Face light towards track
+		transform.RotateY(atan2(lights[i].direction.x, lights[i].direction.z));
 
-			glm::vec3 nextPos;
-			if (m_pCatmullRom->Sample(distance + 0.1f, nextPos)) {
-				glm::vec3 T = glm::normalize(nextPos - coinPosition);
-				glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
-				glm::vec3 N = glm::normalize(glm::cross(T, worldUp));
-
-				coinPosition += N * (trackWidth * 0.5f * lateralOffset);
-			}
+		//Tilt light downwards
+		transform.RotateX(glm::radians(-78.0f));
 
-			// Raise coins slightly higher to be more visible
-			coinPosition.y += 2.5f;
+		transform.Scale(10.0f, 10.0f, 10.0f);
 
-			// Store the coin position for collision detection
-			if (m_coinPositions.size() > i) {
-				m_coinPositions[i] = coinPosition;
-			}
-
-			modelViewMatrixStack.Push();
-			modelViewMatrixStack.Translate(coinPosition);
-
-			// Spin animation for coins
-			float spinSpeed = 250.0f;
-			float spinAngle = fmod(spinSpeed * m_elapsedTime / 1000.0f, 360.0f);
-			modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), glm::radians(spinAngle));
-
-			// Wobble animation for coins
-			float wobbleAmount = 10.0f;
-			float wobbleSpeed = 3.0f;
-			float wobbleAngle = glm::radians(wobbleAmount * sin(wobbleSpeed * m_elapsedTime / 1000.0f));
-			modelViewMatrixStack.Rotate(glm::vec3(1.0f, 0.0f, 0.0f), wobbleAngle);
-
-			pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-			pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-
-			m_pCoin->Render();
+		m_lightPositions.push_back(lights[i].position);
+		m_lightDirections.push_back(lights[i].direction);
+		m_lightColours.push_back(lights[i].colour);
+		lightTransforms.push_back(transform.Top());
+		lightSpheres.push_back(BoundingSphere(lights[i].position, m_pLightMesh->GetBoundingRadius() * 10.0f));
+	}
+	m_pLightInstances->Create(lightTransforms);
+	m_pLightTree->Build(lightSpheres);
+	m_trackLights.resize(lights.size());
+}
 
-			modelViewMatrixStack.Pop();
+// Shows the instances whose bounding spheres are in the frustum and hides the rest, along with any whose bit is set in pHidden
+void Game::CullInstances(CBoundingSphereTree* pTree, CInstanceBuffer* pInstances, const vector<uint64_t>* pHidden)
+{
+	std::vector<int>& visible = m_visibleInstances;
+	visible.clear();
+	pTree->Query(*m_pFrustum, visible, m_pCullStats);
+	int numLeaves = pTree->GetNumLeaves();
+
+	// Drop the hidden ones from the visible list.  Both are in ascending order, and runs of hidden instances are
+	// skipped a word of the mask at a time
+	if (pHidden != NULL) {
+		size_t kept = 0;
+		int shown = CCollectibleSet::NextUncollected(*pHidden, numLeaves, 0);
+		for (size_t v = 0; v < visible.size() && shown != -1; v++) {
+			if (shown < visible[v])
+				shown = CCollectibleSet::NextUncollected(*pHidden, numLeaves, visible[v]);
+			if (shown == visible[v])
+				visible[kept++] = visible[v];
 		}
+		visible.resize(kept);
+	}
+
+	// Walk the visible list alongside the instances
+	size_t next = 0;
+	for (int i = 0; i < numLeaves; i++) {
+		bool show = next < visible.size() && visible[next] == i;
+		if (show)
+			next++;
+		pInstances->SetVisible(i, show);
 	}
 }
 
+void Game::RenderCoinsAlongTrack()
+{
+	PROFILE_ZONE("Game::RenderCoinsAlongTrack");
+
+	// Spin and wobble are applied in the vertex shader, so all coins are drawn with one call.
+	// Collected coins and coins outside the frustum are left out of the instance buffer
+	CullInstances(m_pCoinTree, m_pCoinInstances, &m_pRaceSimulation->GetSnapshot().coinsCollected);
+	if (m_pCoinInstances->GetNumInstances() == 0)
+		return;
+
+	RenderPacket coins;
+	coins.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_COIN, MESH_COIN, 0.0f);
+	coins.draw = DrawCoins;
+	coins.pObject = m_pCoin;
+	coins.pArgument = m_pCoinInstances;
+	coins.instanced = true;
+	coins.gpuPass = GPU_PASS_COINS;
+	m_pRenderQueue->Submit(coins);
+}
+
 void Game::RenderTyresAlongTrack()
 {
+	PROFILE_ZONE("Game::RenderTyresAlongTrack");
 	//Almost identical logic to rendering coins
-	CShaderProgram* pMainProgram = (*m_pShaderPrograms)[0];
-
-	glutil::MatrixStack modelViewMatrixStack;
-	modelViewMatrixStack.SetIdentity();
-
-	modelViewMatrixStack.LookAt(m_pCamera->GetPosition(), m_pCamera->GetView(), m_pCamera->GetUpVector());
-
-	pMainProgram->SetUniform("material1.Ma", glm::vec3(0.2f));
-	pMainProgram->SetUniform("material1.Md", glm::vec3(0.6f, 0.6f, 0.6f));
-	pMainProgram->SetUniform("material1.Ms", glm::vec3(0.4f));
-	pMainProgram->SetUniform("material1.shininess", 10.0f);
-
-	float trackLength = m_pCatmullRom->GetTrackLength();
-	float tyreSpacing = 100.0f;
-	int numTyres = static_cast<int>(trackLength / tyreSpacing);
-
-	float maxLateralOffset = 0.7f;
-	float trackWidth = 50.0f;
-
-	if (m_tyrePositions.empty()) {
-		m_tyrePositions.resize(numTyres);
-	}
-
-	for (int i = 0; i < numTyres; i++) {
-		float distance = i * tyreSpacing + (tyreSpacing / 2.0f); // Offset from coins
-		glm::vec3 tyrePosition;
-		glm::vec3 up;
+	CullInstances(m_pTyreTree, m_pTyreInstances, NULL);
+	if (m_pTyreInstances->GetNumInstances() == 0)
+		return;
+
+	RenderPacket tyres;
+	tyres.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_TYRE, MESH_TYRE, 0.0f);
+	tyres.draw = DrawTyres;
+	tyres.pObject = m_pTyre;
+	tyres.pArgument = m_pTyreInstances;
+	tyres.instanced = true;
+	tyres.gpuPass = GPU_PASS_TYRES;
+	m_pRenderQueue->Submit(tyres);
+}
 
-		if (m_pCatmullRom->Sample(distance, tyrePosition, up)) {
-			float zigzagFactor = sin(i * 0.5f);
-			float lateralOffset = maxLateralOffset * -zigzagFactor; //Negative so its placed opposite to coins
+// Fills in the light block for this frame and uploads it with a single buffer update.  The track lights are
+// binned into view-space clusters so each fragment only evaluates the ones in range
+void Game::UpdateLightBlock(const glm::mat4& viewMatrix)
+{
+	PROFILE_ZONE("Game::UpdateLightBlock");
+	glm::mat3 viewNormalMatrix = m_pCamera->ComputeNormalMatrix(viewMatrix);
 
-			glm::vec3 nextPos;
-			if (m_pCatmullRom->Sample(distance + 0.1f, nextPos)) {
-				glm::vec3 T = glm::normalize(nextPos - tyrePosition);
-				glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
-				glm::vec3 N = glm::normalize(glm::cross(T, worldUp));
+	LightBlock& lights = *m_pLightData;
 
-				tyrePosition += N * (trackWidth * 0.5f * lateralOffset);
-			}
+	glm::vec4 lightPosition1 = glm::vec4(-100, 100, -100, 1); // Position of light source *in world coordinates*
+	lights.light1.position = viewMatrix * lightPosition1; // Position of light source *in eye coordinates*
+	lights.light1.La = glm::vec3(0.06f, 0.06f, 0.08f);  // Increased ambient light for better visibility
+	lights.light1.Ld = glm::vec3(0.0f);                 // No diffuse light
+	lights.light1.Ls = glm::vec3(0.0f);                 // No specular
+	lights.light1.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	lights.light1.exponent = 1.0f;
+	lights.light1.cutoff = 180.0f;
 
-			tyrePosition.y += 1.0f; // Position on the track
+	int numLights = (int)m_lightPositions.size();
+	glm::vec3 ambientSum = glm::vec3(0.0f);
 
-			if (m_tyrePositions.size() > i) {
-				m_tyrePositions[i] = tyrePosition;
+	for (int i = 0; i < numLights; i++) {
+		float flickerMultiplier = 1.0f;
+
+		//Flicker lights
+		if (m_lightsFlickering) {
+			float t = (float)(m_gameTime / 1000.0); // Get time in seconds
+
+			//Numbers used when multiplying are random to generate a random-looking, distributed range of values
+			//This specific light has a pseudo-random value assigned to it based on current time
+			float flickerChance = glm::fract(glm::sin(float(i) * 19.7f + t * 2.5f) * 57683.2f);
+			//10% chance for light to flicker
+			if (flickerChance < 0.1f) {
+				float innerNoise = glm::fract(glm::cos(float(i) * 36.8f + t * 18.0f) * 23941.7f); //Generate random number for intensity of flicker
+				flickerMultiplier = glm::mix(0.3f, 0.7f, innerNoise); //Interpolate between 0.3 and 0.7 based on inner noise. this ensures that lights don't turn off when flickering, more so dims and undims
 			}
+		}
 
-			modelViewMatrixStack.Push();
-			modelViewMatrixStack.Translate(tyrePosition);
+		ClusteredLight& light = m_trackLights[i];
 
-			// Rotate the tyre to face the track direction
-			glm::vec3 nextPosForRotation;
-			if (m_pCatmullRom->Sample(distance + 0.1f, nextPosForRotation)) {
-				glm::vec3 direction = glm::normalize(nextPosForRotation - tyrePosition);
-				float yaw = atan2(-direction.x, -direction.z);
-				modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), yaw);
+		glm::vec3 lightDirEyeSpace = glm::normalize(viewNormalMatrix * m_lightDirections[i]);
 
-				modelViewMatrixStack.Rotate(glm::vec3(0.0f, 0.0f, 1.0f), glm::radians(5.0f));
-			}
+		//Spotlight parameters: exponent 0.5, cutoff 75
+		light.position = glm::vec4(glm::vec3(viewMatrix * glm::vec4(m_lightPositions[i], 1.0f)), 0.5f);
+		light.direction = glm::vec4(lightDirEyeSpace, 75.0f);
 
-			modelViewMatrixStack.Scale(6.0f, 6.0f, 6.0f);
+		light.La = glm::vec4(glm::vec3(0.1f), 0.0f);
+		light.Ld = glm::vec4(m_lightColours[i] * flickerMultiplier, 0.0f); //Apply the flicking multiplier to the light which constantly changes
+		light.Ls = glm::vec4(m_lightColours[i] * 1.5f * flickerMultiplier, 0.0f);
 
-			pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-			pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
+		// The shader used to loop over at most 16 track lights, each adding its ambient term to every fragment
+		// whatever its range.  The same sum is passed as one term, so the ambient is unchanged however many lights
+		// the track has
+		if (i < 16)
+			ambientSum += glm::vec3(light.La);
+	}
+	lights.trackAmbient = glm::vec4(ambientSum, 0.0f);
 
-			m_pTyre->Render();
+	// Lights have no effect beyond 80 units (maxRange in mainShader.frag)
+	m_pLightClusters->Update(m_trackLights, 80.0f, *m_pCamera->GetPerspectiveProjectionMatrix());
+	lights.clusterDims = m_pLightClusters->GetDimensions();
+	lights.clusterDepth = m_pLightClusters->GetDepthParameters();
 
-			modelViewMatrixStack.Pop();
-		}
-	}
+	m_pLightBlock->Update(m_pLightData, sizeof(LightBlock));
 }
 
 void Game::RenderLightMeshesAlongTrack()
 {
-	CShaderProgram* pMainProgram = (*m_pShaderPrograms)[0];
-
-	glutil::MatrixStack modelViewMatrixStack;
-	modelViewMatrixStack.SetIdentity();
-
-	modelViewMatrixStack.LookAt(m_pCamera->GetPosition(), m_pCamera->GetView(), m_pCamera->GetUpVector());
-	glm::mat4 viewMatrix = modelViewMatrixStack.Top();
-	glm::mat3 viewNormalMatrix = m_pCamera->ComputeNormalMatrix(viewMatrix);
-
-	pMainProgram->SetUniform("material1.Ma", glm::vec3(0.8f));
-	pMainProgram->SetUniform("material1.Md", glm::vec3(0.8f));
-	pMainProgram->SetUniform("material1.Ms", glm::vec3(1.0f));
-	pMainProgram->SetUniform("material1.shininess", 40.0f);
-
-	float trackLength = m_pCatmullRom->GetTrackLength();
-	float lightSpacing = 30.0f; // Spacing between lights
-	int numLights = static_cast<int>(trackLength / lightSpacing);
-
-	// Limit to maximum supported lights
-	if (numLights > 16) {
-		lightSpacing = trackLength / 16.0f;
-		numLights = 16;
-	}
-
-	float trackWidth = 50.0f;
-	float lightOffset = 1.2f; // Spacing from track edge
-
-	// Initialize light positions 
-	if (m_lightPositions.empty() || m_lightPositions.size() != numLights) {
-		m_lightPositions.resize(numLights);
-	}
-
-	pMainProgram->SetUniform("numActiveLights", numLights);
-
-	// Initialise all lights to off
-	for (int i = 0; i < 16; i++) {
-		//Strng accesses array element in shaders and can be used to adjust the different parameters
-		std::string lightIdx = "trackLights[" + std::to_string(i) + "]";
-		pMainProgram->SetUniform(lightIdx + ".position", viewMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
-		pMainProgram->SetUniform(lightIdx + ".direction", glm::vec3(0.0f, -1.0f, 0.0f));
-		pMainProgram->SetUniform(lightIdx + ".La", glm::vec3(0.0f));
-		pMainProgram->SetUniform(lightIdx + ".Ld", glm::vec3(0.0f));
-		pMainProgram->SetUniform(lightIdx + ".Ls", glm::vec3(0.0f));
-		pMainProgram->SetUniform(lightIdx + ".exponent", 10.0f);
-		pMainProgram->SetUniform(lightIdx + ".cutoff", 25.0f);
-	}
-
-	for (int i = 0; i < numLights; i++) {
-		// Calculate position along track 
-		float distance = i * lightSpacing;
-		glm::vec3 lightPosition;
-		glm::vec3 up;
-
-		if (m_pCatmullRom->Sample(distance, lightPosition, up)) {
-			// Alternate between left and right of the track
-			float side = (i % 2 == 0) ? 1.0f : -1.0f;
-
-			// Get the next point for track direction
-			glm::vec3 nextPos;
-			if (m_pCatmullRom->Sample(distance + 0.1f, nextPos)) {
-				// Calculate track vectors
-				glm::vec3 T = glm::normalize(nextPos - lightPosition);
-				glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
-				glm::vec3 N = glm::normalize(glm::cross(T, worldUp));
-
-				// Position light post at the side of the track
-				glm::vec3 postPosition = lightPosition + N * (trackWidth * 0.5f * lightOffset * side);
-				postPosition.y += 0.5f;
-
-				// Position spotlight at the base of the light mesh
-				glm::vec3 finalLightPosition = postPosition;
-
-				if (m_lightPositions.size() > i) {
-					m_lightPositions[i] = finalLightPosition;
-				}
-
-				// Target light onto track
-				glm::vec3 targetPointOnTrack = lightPosition + N * (trackWidth * 0.2f * side * -1.0f);
-				targetPointOnTrack.y += 0.1f; // Just above track surface
-
-				// Calculate direction from light to target point
-				glm::vec3 lightDirection = glm::normalize(targetPointOnTrack - finalLightPosition);
-
-				// Apply colours to lights
-				glm::vec3 lightColour;
-				float baseIntensity = 50.0f;
-				switch (i % 4) {
-				case 0: lightColour = glm::vec3(1.0f, 0.2f, 0.1f) * baseIntensity; break; // Red
-				case 1: lightColour = glm::vec3(0.2f, 0.2f, 1.0f) * baseIntensity; break; // Blue
-				case 2: lightColour = glm::vec3(1.0f, 0.7f, 0.1f) * baseIntensity; break; // Yellow
-				case 3: lightColour = glm::vec3(0.2f, 1.0f, 0.3f) * baseIntensity; break; // Green
-				}
-
-				bool lightOn = true;
-
-				float flickerMultiplier = 1.0f;
-
-				//Flicker lights
-				if (m_lightsFlickering) {
-					float t = m_elapsedTime / 1000.0f; // Get time in seconds
-
-					//Numbers used when multiplying are random to generate a random-looking, distributed range of values
-					//This specific light has a pseudo-random value assigned to it based on current time
-					float flickerChance = glm::fract(glm::sin(float(i) * 19.7f + t * 2.5f) * 57683.2f);
-					//10% chance for light to flicker
-					if (flickerChance < 0.1f) {
-						float innerNoise = glm::fract(glm::cos(float(i) * 36.8f + t * 18.0f) * 23941.7f); //Generate random number for intensity of flicker
-						flickerMultiplier = glm::mix(0.3f, 0.7f, innerNoise); //Interpolate between 0.3 and 0.7 based on inner noise. this ensures that lights don't turn off when flickering, more so dims and undims
-					}
-				}
-
-				if (lightOn) {
-					//String accesses array element in shaders and can be used to adjust the different parameters
-					std::string lightIdx = "trackLights[" + std::to_string(i) + "]";
-
-					pMainProgram->SetUniform(lightIdx + ".position", viewMatrix * glm::vec4(finalLightPosition, 1.0f));
-					glm::vec3 lightDirEyeSpace = viewNormalMatrix * lightDirection;
-					pMainProgram->SetUniform(lightIdx + ".direction", glm::normalize(lightDirEyeSpace));
-
-					pMainProgram->SetUniform(lightIdx + ".La", glm::vec3(0.1f));
-					pMainProgram->SetUniform(lightIdx + ".Ld", lightColour * flickerMultiplier); //Apply the flicking multiplier to the light which constantly changes
-					pMainProgram->SetUniform(lightIdx + ".Ls", lightColour * 1.5f * flickerMultiplier);
-
-					//Spotlight parameters
-					pMainProgram->SetUniform(lightIdx + ".exponent", 0.5f);
-					pMainProgram->SetUniform(lightIdx + ".cutoff", 75.0f);
-				}
-
-				modelViewMatrixStack.Push();
-				modelViewMatrixStack.Translate(finalLightPosition);
-				glm::vec3 forward = glm::normalize(targetPointOnTrack - finalLightPosition);
-
-				// Face light towards track
-				modelViewMatrixStack.RotateY(atan2(forward.x, forward.z));
-
-				//Tilt light downwards
-				modelViewMatrixStack.RotateX(glm::radians(-78.0f));
-
-				modelViewMatrixStack.Scale(10.0f, 10.0f, 10.0f);
-
-				pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-				pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-
-				m_pLightMesh->Render();
-				modelViewMatrixStack.Pop();
-			}
-		}
-	}
+	PROFILE_ZONE("Game::RenderLightMeshesAlongTrack");
+	CullInstances(m_pLightTree, m_pLightInstances, NULL);
+	if (m_pLightInstances->GetNumInstances() == 0)
+		return;
+
+	RenderPacket lights;
+	lights.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_LIGHT_POST, MESH_LIGHT_POST, 0.0f);
+	lights.draw = DrawMeshInstanced;
+	lights.pObject = m_pLightMesh;
+	lights.pArgument = m_pLightInstances;
+	lights.instanced = true;
+	lights.gpuPass = GPU_PASS_LIGHTS;
+	m_pRenderQueue->Submit(lights);
 }
 
 void Game::DisplayFrameRate()
 {
 	CShaderProgram* fontProgram = (*m_pShaderPrograms)[1];
+	const RaceSnapshot& snapshot = m_pRaceSimulation->GetSnapshot();
 
 	RECT dimensions = m_gameWindow.GetDimensions();
 	int height = dimensions.bottom - dimensions.top;
@@ -813,25 +809,50 @@ void Game::DisplayFrameRate()
 	if (m_framesPerSecond > 0) {
 		// Use the font shader program and render the text
 		fontProgram->UseProgram();
-		glDisable(GL_DEPTH_TEST);
+		CGLStateCache::Disable(GL_DEPTH_TEST);
 		fontProgram->SetUniform("matrices.modelViewMatrix", glm::mat4(1));
 		fontProgram->SetUniform("matrices.projMatrix", m_pCamera->GetOrthographicProjectionMatrix());
 		fontProgram->SetUniform("vColour", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 		m_pFtFont->Render(20, height - 20, 20, "FPS: %d", m_framesPerSecond); //Display FPS
 
 		fontProgram->SetUniform("vColour", glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
-		m_pFtFont->Render(20, height - 50, 20, "Score: %d", m_score); //Display Score
+		m_pFtFont->Render(20, height - 50, 20, "Score: %d", snapshot.score); //Display Score
 		fontProgram->SetUniform("vColour", glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
-		m_pFtFont->Render(20, height - 80, 20, "Lives: %d", m_lives); //Display Lives
+		m_pFtFont->Render(20, height - 80, 20, "Lives: %d", snapshot.lives); //Display Lives
 		fontProgram->SetUniform("vColour", glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
 
-		m_pFtFont->Render(20, height - 110, 20, "Current Lap: %d", m_pCatmullRom->CurrentLap(m_currentDistance) + 1); //Display Current Lap
+		m_pFtFont->Render(20, height - 110, 20, "Current Lap: %d", snapshot.lap + 1); //Display Current Lap
 		fontProgram->SetUniform("vColour", glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
 
-		if (m_gameOver) {
+		m_pFtFont->Render(20, height - 140, 20, "Visible: %d  Culled: %d", m_pCullStats->visible, m_pCullStats->culled); //Objects and track chunks that passed / failed the frustum test this frame
+		m_pFtFont->Render(20, height - 170, 20, "Track triangles: %d", m_pTrackMesh->GetTrackTriangles()); //After level of detail selection
+		m_pFtFont->Render(20, height - 200, 20, "GL state calls: %d issued, %d skipped", m_stateCallsIssued, m_stateCallsSkipped); //Binds and toggles last frame, with and without a change
+		const RenderQueueStats& queueStats = m_pRenderQueue->GetStats();
+		m_pFtFont->Render(20, height - 230, 20, "Draws: %d  Material changes: %d", queueStats.packets, queueStats.materialChanges); //Packets drawn by the render queue this frame
+		GeometryArenaStats arenaStats = CGeometryArena::GetStats();
+		m_pFtFont->Render(20, height - 260, 20, "Geometry: %d meshes, %d KB", arenaStats.allocations, (int)(arenaStats.bytesUsed / 1024)); //Ranges held in the shared vertex and index buffers
+
+		m_pFtFont->Render(20, height - 290, 20, "Uniforms set by name: %d", m_uncachedUniformLookups); //Hashed lookups last frame, rather than handles
+
+		//Names the shaders don't have (unused or misspelt). Only shown if there are any
+		if (m_missingUniformLookups > 0) {
+			fontProgram->SetUniform("vColour", glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+			m_pFtFont->Render(20, height - 320, 20, "Missing uniforms set: %d", m_missingUniformLookups);
+		}
+
+		if (snapshot.gameOver) {
 			fontProgram->SetUniform("vColour", glm::vec4(1.0f, 0.0f, 1.0f, 1.0f));
 			m_pFtFont->Render(150, height - 20, 20, "GAME OVER");//Display game over if condition is met
 		}
+
+		//GPU time per render pass, a few frames behind. Toggled with G
+		if (m_showGpuTimes && m_pGpuTimer->IsSupported()) {
+			int x = dimensions.right - dimensions.left - 220;
+			fontProgram->SetUniform("vColour", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+			m_pFtFont->Render(x, height - 20, 20, "GPU frame: %.2f ms", m_pGpuTimer->GetFrameTime());
+			for (int i = 0; i < NUM_GPU_PASSES; i++)
+				m_pFtFont->Render(x, height - 50 - 25 * i, 16, "%s: %.2f ms", CGpuTimer::GetPassName((GpuPass)i), m_pGpuTimer->GetPassTime((GpuPass)i));
+		}
 	}
 }
 
@@ -849,17 +870,19 @@ void Game::GameLoop()
 	*/
 
 
-	// Variable timer
+	// Variable timer. The frame time is measured before updating, so the simulation catches up on the time that has
+	// actually passed rather than on how long the previous frame took to draw
+	m_dt = m_pHighResolutionTimer->Elapsed();
 	m_pHighResolutionTimer->Start();
 	Update();
 	Render();
-	m_dt = m_pHighResolutionTimer->Elapsed();
 
 
 }
 
 WPARAM Game::Execute()
 {
+	PROFILE_THREAD("Main");
 	m_pHighResolutionTimer = new CHighResolutionTimer;
 	m_gameWindow.Init(m_hInstance);
 
@@ -870,6 +893,7 @@ WPARAM Game::Execute()
 	Initialise();
 
 	m_pHighResolutionTimer->Start();
+	m_pRaceSimulation->Start();
 
 
 	MSG msg;
@@ -889,6 +913,7 @@ WPARAM Game::Execute()
 		else Sleep(200); // Do not consume processor power if application isn't active
 	}
 
+	m_pRaceSimulation->Stop();
 	m_gameWindow.Deinit();
 
 	return(msg.wParam);
@@ -909,9 +934,13 @@ LRESULT Game::ProcessEvents(HWND window, UINT message, WPARAM w_param, LPARAM l_
 		case WA_CLICKACTIVE:
 			m_appActive = true;
 			m_pHighResolutionTimer->Start();
+			if (m_pRaceSimulation != NULL)
+				m_pRaceSimulation->SetPaused(false);
 			break;
 		case WA_INACTIVE:
 			m_appActive = false;
+			if (m_pRaceSimulation != NULL)
+				m_pRaceSimulation->SetPaused(true);
 			break;
 		}
 		break;
@@ -958,36 +987,11 @@ LRESULT Game::ProcessEvents(HWND window, UINT message, WPARAM w_param, LPARAM l_
 			m_thirdPerson = false;
 			m_topView = true;
 			break;
-		case 'W':
-			m_accelerating = true;
-			break;
-		case 'S':
-			m_breaking = true;
-			break;
-		case 'A':
-			m_turnLeft = true;
-			m_turnRight = false;
-			break;
-		case 'D':
-			m_turnLeft = false;
-			m_turnRight = true;
-			break;
-		}
-		break;
-	case WM_KEYUP:
-		switch (w_param) {
-		case 'W':
-			m_decelerating = true;
-			m_accelerating = false;
-			break;
-		case 'S':
-			m_breaking = false;
-			break;
-		case 'A':
-			m_turnLeft = false;
+		case 'P':
+			CProfiler::WriteChromeTrace("profile.json"); // Open in chrome://tracing or ui.perfetto.dev
 			break;
-		case 'D':
-			m_turnRight = false;
+		case 'G':
+			m_showGpuTimes = !m_showGpuTimes;
 			break;
 		}
 		break;
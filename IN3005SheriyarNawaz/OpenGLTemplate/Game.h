@@ -3,6 +3,7 @@
 #include "Common.h"
 #include "GameWindow.h"
 #include <math.h>
+#include <stdint.h>
 
 // Classes used in game.  For a new class, declare it here and provide a pointer to an object of this class below.  Then, in Game.cpp, 
 // include the header.  In the Game constructor, set the pointer to NULL and in Game::Initialise, create a new object.  Don't forget to 
@@ -18,17 +19,33 @@ class CSphere;
 class COpenAssetImportMesh;
 class CAudio;
 class CCatmullRom;
+class CTrackMesh;
 class CCoin;
 class CTyre;
+class CInstanceBuffer;
+struct SplineCursor;
+class CUniformBuffer;
+class CLightClusters;
+class CFrustum;
+class CBoundingSphereTree;
+struct CullStats;
+class CTrackBroadphase;
+class CCollectibleSet;
+class CRaceSimulation;
+struct LightBlock;
+struct ClusteredLight;
+class CGpuTimer;
+class CRenderQueue;
 
 class Game {
 private:
 	// Three main methods used in the game.  Initialise runs once, while Update and Render run repeatedly in the game loop.
 	void Initialise();
 	void Update();
-	void HandleCameraAngles(glm::vec3& T, glm::vec3& B);
-	void HandleCameraShake(glm::vec3& T, glm::vec3& B);
+	void HandleCameraAngles(glm::vec3& T, glm::vec3& B, const glm::vec3& shakeOffset);
 	void StartCameraShake();
+	void BakeTrackPlacements();
+	void CullInstances(CBoundingSphereTree* pTree, CInstanceBuffer* pInstances, const vector<uint64_t>* pHidden);
 	void RenderCoinsAlongTrack();
 	void RenderTyresAlongTrack();
 	void Render();
@@ -47,60 +64,60 @@ private:
 	CHighResolutionTimer* m_pHighResolutionTimer;
 	CAudio* m_pAudio;
 	CCatmullRom* m_pCatmullRom;
+	CTrackMesh* m_pTrackMesh;
 	CCoin* m_pCoin;
 	CTyre* m_pTyre;
+	SplineCursor* m_pCarRenderCursor;
+	CInstanceBuffer* m_pCoinInstances;
+	CInstanceBuffer* m_pTyreInstances;
+	CInstanceBuffer* m_pLightInstances;
+	CUniformBuffer* m_pCameraBlock;
+	CUniformBuffer* m_pLightBlock;
+	LightBlock* m_pLightData;
+	CLightClusters* m_pLightClusters;
+	CFrustum* m_pFrustum;
+	CBoundingSphereTree* m_pCoinTree;
+	CBoundingSphereTree* m_pTyreTree;
+	CBoundingSphereTree* m_pLightTree;
+	CullStats* m_pCullStats;
+	CTrackBroadphase* m_pCoinBroadphase;
+	CTrackBroadphase* m_pTyreBroadphase;
+	CCollectibleSet* m_pCoins;
+	CCollectibleSet* m_pTyres;
+	CRaceSimulation* m_pRaceSimulation;
+	CGpuTimer* m_pGpuTimer;
+	CRenderQueue* m_pRenderQueue;
 
 	// Some other member variables
 	double m_dt;
 	int m_framesPerSecond;
+	int m_uncachedUniformLookups;
+	int m_missingUniformLookups;
+	int m_stateCallsIssued;
+	int m_stateCallsSkipped;
 	bool m_appActive;
-	glm::vec3 m_carPosition;
+	bool m_showGpuTimes;
+	glm::vec3 m_carRenderPosition;			// Position interpolated between the last two simulation steps, for drawing
+	double m_gameTime;						// Time since the start, in ms, for animation
 
 	bool m_freeLook;
 	bool m_topView;
 	bool m_firstPerson;
 	bool m_thirdPerson;
 
-	bool m_turnRight;
-	bool m_turnLeft;
-	bool m_accelerating;
-	bool m_decelerating;
-	bool m_breaking;
-
-	float m_carSpeed;
-	float m_carRotation;
-	float m_maxSpeed;
-	float m_acceleration;
-	float m_deceleration;
-	float m_turnSpeed;
-	float m_breakSpeed;
-
-	float m_currentDistance;
-	float m_sidePosition;
-	float m_furthestSidePosition;
-	std::vector<glm::vec3> m_coinPositions;
-	std::vector<bool> m_coinCollected;
-
-	std::vector<glm::vec3> m_tyrePositions;
-	std::vector<bool> m_tyreHit;
+	float m_carRenderRotation;
 
 	std::vector<glm::vec3> m_lightPositions;
+	std::vector<glm::vec3> m_lightDirections;
+	std::vector<glm::vec3> m_lightColours;
+	std::vector<ClusteredLight> m_trackLights;		// Eye-space lights for the clusters, sized once and overwritten each frame
+	std::vector<int> m_visibleInstances;			// Scratch for CullInstances, kept so that culling doesn't allocate each frame
 	bool m_lightsFlickering;
 	float m_lightFlickerRate;
 
-	float m_collisionCooldown;
-	int m_score;
-	int m_lives;
-	bool m_gameOver;
-
-	void CheckCollision();
+	void UpdateLightBlock(const glm::mat4& viewMatrix);
 	void RenderLightMeshesAlongTrack();
 
-	bool m_cameraShaking;
-	float m_shakeTime;
-	float m_shakeDuration;
-	float m_shakeIntensity;
-
 public:
 	Game();
 	~Game();
@@ -111,6 +128,7 @@ public:
 
 private:
 	static const int FPS = 60;
+	static const int MAX_FRAME_TIME = 250;	// Longest frame (ms) animations will jump by
 	void DisplayFrameRate();
 	void GameLoop();
 	GameWindow m_gameWindow;
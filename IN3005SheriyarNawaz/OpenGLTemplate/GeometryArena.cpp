@@ -0,0 +1,238 @@
+#include "GeometryArena.h"
+#include "GLStateCache.h"
+#include <stddef.h>
+#include <string.h>
+
+// Room for the first buffer of each kind, in vertices or indices, unless the first allocation needs more
+static const GLuint INITIAL_CAPACITY = 4096;
+
+// A run of unused elements
+struct FreeBlock
+{
+	GLuint offset;
+	GLuint size;
+};
+
+// One GL buffer and the free space in it, in elements
+struct ArenaBuffer
+{
+	GLuint buffer;
+	GLuint elementSize;
+	GLuint capacity;
+	GLuint used;
+	vector<FreeBlock> freeBlocks;		// In offset order, never touching
+};
+
+static const GLsizei s_vertexSizes[NUM_VERTEX_FORMATS] = { sizeof(MeshVertex), sizeof(TextVertex) };
+
+static ArenaBuffer s_vertexBuffers[NUM_VERTEX_FORMATS];
+static ArenaBuffer s_indexBuffer;
+static GLuint s_vaos[NUM_VERTEX_FORMATS];
+static int s_allocations = 0;
+
+// Points a format's VAO at its vertex buffer and at the index buffer.  Done again whenever either is replaced
+static void SetUpVertexArray(VertexFormat format)
+{
+	CGLStateCache::BindVertexArray(s_vaos[format]);
+	glBindBuffer(GL_ARRAY_BUFFER, s_vertexBuffers[format].buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_indexBuffer.buffer);
+
+	GLsizei stride = s_vertexSizes[format];
+	if (format == VERTEX_FORMAT_MESH) {
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshVertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshVertex, texCoord));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshVertex, normal));
+	}
+	else {
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(TextVertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(TextVertex, texCoord));
+	}
+}
+
+// Adds a block to the free list, joining it to its neighbours where they touch
+static void ReleaseBlock(ArenaBuffer& arena, GLuint offset, GLuint size)
+{
+	vector<FreeBlock>& blocks = arena.freeBlocks;
+	size_t i = 0;
+	while (i < blocks.size() && blocks[i].offset < offset)
+		i++;
+
+	FreeBlock block = { offset, size };
+	blocks.insert(blocks.begin() + i, block);
+
+	if (i + 1 < blocks.size() && blocks[i].offset + blocks[i].size == blocks[i + 1].offset) {
+		blocks[i].size += blocks[i + 1].size;
+		blocks.erase(blocks.begin() + i + 1);
+	}
+	if (i > 0 && blocks[i - 1].offset + blocks[i - 1].size == blocks[i].offset) {
+		blocks[i - 1].size += blocks[i].size;
+		blocks.erase(blocks.begin() + i);
+	}
+}
+
+// Replaces the buffer with a larger one holding the same contents, so that at least size more elements fit at the end
+static void Grow(ArenaBuffer& arena, GLuint size)
+{
+	GLuint capacity = glm::max(arena.capacity * 2, INITIAL_CAPACITY);
+	while (capacity < arena.capacity + size)
+		capacity *= 2;
+
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)capacity * arena.elementSize, NULL, GL_STATIC_DRAW);
+
+	if (arena.buffer != 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, arena.buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)arena.capacity * arena.elementSize);
+		glDeleteBuffers(1, &arena.buffer);
+	}
+
+	ReleaseBlock(arena, arena.capacity, capacity - arena.capacity);
+	arena.buffer = buffer;
+	arena.capacity = capacity;
+}
+
+// First fit, growing the buffer if nothing fits
+static GLuint AllocateBlock(ArenaBuffer& arena, GLuint size, bool& grown)
+{
+	grown = false;
+	for (int attempt = 0; attempt < 2; attempt++) {
+		vector<FreeBlock>& blocks = arena.freeBlocks;
+		for (size_t i = 0; i < blocks.size(); i++) {
+			if (blocks[i].size < size)
+				continue;
+
+			GLuint offset = blocks[i].offset;
+			blocks[i].offset += size;
+			blocks[i].size -= size;
+			if (blocks[i].size == 0)
+				blocks.erase(blocks.begin() + i);
+			arena.used += size;
+			return offset;
+		}
+
+		Grow(arena, size);
+		grown = true;
+	}
+	return 0;
+}
+
+// Maps just the new range, write-only and invalidated, so the driver doesn't read the old contents back, and copies the
+// data straight into it.  The mapping is left synchronised: without GL_MAP_UNSYNCHRONIZED_BIT the driver may still wait
+// for draws that use the buffer.  That can't be ruled out, since a freed range may be handed straight back out (a mesh
+// re-uploaded frees its old range first) while a draw from it is in flight.  Geometry is only written while loading
+static void Write(ArenaBuffer& arena, GLuint offset, const void* pData, GLuint size)
+{
+	// Written through the copy target, so that no VAO's index buffer binding is disturbed
+	GLintptr byteOffset = (GLintptr)offset * arena.elementSize;
+	GLsizeiptr byteSize = (GLsizeiptr)size * arena.elementSize;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, arena.buffer);
+	void* pMapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, byteOffset, byteSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (pMapped != NULL) {
+		memcpy(pMapped, pData, byteSize);
+		if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE)
+			return;
+	}
+
+	// The mapping failed, or its contents were lost (e.g. a mode change) before the unmap
+	glBufferSubData(GL_COPY_WRITE_BUFFER, byteOffset, byteSize, pData);
+}
+
+GeometryRange CGeometryArena::Allocate(VertexFormat format, const void* pVertices, int numVertices, const GLuint* pIndices, int numIndices)
+{
+	ArenaBuffer& vertices = s_vertexBuffers[format];
+	vertices.elementSize = s_vertexSizes[format];
+	s_indexBuffer.elementSize = sizeof(GLuint);
+
+	GeometryRange range;
+	range.format = format;
+	if (numVertices <= 0 && numIndices <= 0)
+		return range;
+	range.vertexCount = numVertices;
+	range.indexCount = numIndices;
+
+	bool vertexBufferGrown = false, indexBufferGrown = false;
+	if (numVertices > 0) {
+		range.baseVertex = (GLint)AllocateBlock(vertices, numVertices, vertexBufferGrown);
+		Write(vertices, range.baseVertex, pVertices, numVertices);
+	}
+	if (numIndices > 0) {
+		range.firstIndex = AllocateBlock(s_indexBuffer, numIndices, indexBufferGrown);
+		Write(s_indexBuffer, range.firstIndex, pIndices, numIndices);
+	}
+
+	if (s_vaos[format] == 0) {
+		glGenVertexArrays(1, &s_vaos[format]);
+		SetUpVertexArray(format);
+	}
+	else if (vertexBufferGrown)
+		SetUpVertexArray(format);
+
+	// Every format's VAO refers to the index buffer
+	if (indexBufferGrown) {
+		for (int i = 0; i < NUM_VERTEX_FORMATS; i++) {
+			if (s_vaos[i] != 0) {
+				CGLStateCache::BindVertexArray(s_vaos[i]);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_indexBuffer.buffer);
+			}
+		}
+	}
+
+	s_allocations++;
+	return range;
+}
+
+void CGeometryArena::Free(GeometryRange& range)
+{
+	if (range.vertexCount == 0 && range.indexCount == 0)
+		return;
+
+	if (range.vertexCount > 0) {
+		ArenaBuffer& vertices = s_vertexBuffers[range.format];
+		ReleaseBlock(vertices, range.baseVertex, range.vertexCount);
+		vertices.used -= range.vertexCount;
+	}
+	if (range.indexCount > 0) {
+		ReleaseBlock(s_indexBuffer, range.firstIndex, range.indexCount);
+		s_indexBuffer.used -= range.indexCount;
+	}
+
+	s_allocations--;
+	range = GeometryRange();
+}
+
+void CGeometryArena::Bind(VertexFormat format)
+{
+	CGLStateCache::BindVertexArray(s_vaos[format]);
+}
+
+GLsizei CGeometryArena::GetVertexSize(VertexFormat format)
+{
+	return s_vertexSizes[format];
+}
+
+GeometryArenaStats CGeometryArena::GetStats()
+{
+	GeometryArenaStats stats;
+	stats.allocations = s_allocations;
+
+	for (int i = 0; i <= NUM_VERTEX_FORMATS; i++) {
+		const ArenaBuffer& arena = i < NUM_VERTEX_FORMATS ? s_vertexBuffers[i] : s_indexBuffer;
+		if (arena.buffer == 0)
+			continue;
+		stats.buffers++;
+		stats.bytesUsed += (size_t)arena.used * arena.elementSize;
+		stats.bytesReserved += (size_t)arena.capacity * arena.elementSize;
+	}
+	for (int i = 0; i < NUM_VERTEX_FORMATS; i++) {
+		if (s_vaos[i] != 0)
+			stats.vertexArrays++;
+	}
+	return stats;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Common.h"
+
+// Vertex layouts the arena stores.  Each one has its own vertex buffer and VAO, shared by every mesh in that layout
+enum VertexFormat
+{
+	VERTEX_FORMAT_MESH,			// MeshVertex, attributes 0 to 2 of mainShader.vert
+	VERTEX_FORMAT_TEXT,			// TextVertex, attributes 0 and 1 of textShader.vert
+	NUM_VERTEX_FORMATS
+};
+
+struct MeshVertex
+{
+	MeshVertex() {}
+	MeshVertex(const glm::vec3& p, const glm::vec2& t, const glm::vec3& n) : position(p), texCoord(t), normal(n) {}
+
+	glm::vec3 position;
+	glm::vec2 texCoord;
+	glm::vec3 normal;
+};
+
+struct TextVertex
+{
+	TextVertex() {}
+	TextVertex(const glm::vec2& p, const glm::vec2& t) : position(p), texCoord(t) {}
+
+	glm::vec2 position;
+	glm::vec2 texCoord;
+};
+
+// Where an allocation was placed in the arena.  Its indices count from its own first vertex, so indexed draws pass
+// baseVertex as the base vertex, and non-indexed draws start at it
+struct GeometryRange
+{
+	GeometryRange() : format(VERTEX_FORMAT_MESH), baseVertex(0), vertexCount(0), firstIndex(0), indexCount(0) {}
+
+	GLvoid* GetIndexOffset() const { return (GLvoid*)(firstIndex * sizeof(GLuint)); }	// As glDrawElements takes it
+
+	VertexFormat format;
+	GLint baseVertex;
+	GLsizei vertexCount;
+	GLuint firstIndex;
+	GLsizei indexCount;
+};
+
+// What the arena holds, for the benchmark and the HUD
+struct GeometryArenaStats
+{
+	GeometryArenaStats() : allocations(0), buffers(0), vertexArrays(0), bytesUsed(0), bytesReserved(0) {}
+	int allocations;
+	int buffers;
+	int vertexArrays;
+	size_t bytesUsed;
+	size_t bytesReserved;
+};
+
+// Every mesh's vertices and indices, sub-allocated from one vertex buffer per format and one index buffer shared by all
+// of them.  Meshes keep a GeometryRange rather than buffers of their own, and draw from the format's VAO with base vertex
+// draws, so going from one mesh to another in the same format needs no VAO or buffer change, and ranges from different
+// classes can go in the same multi-draw.  A buffer that fills up is replaced by one twice the size and the contents
+// copied across on the GPU; ranges are offsets, so they stay valid.  Freed ranges are reused, first fit.  The buffers are
+// created on the first allocation, which needs a current GL context
+class CGeometryArena
+{
+public:
+	static GeometryRange Allocate(VertexFormat format, const void* pVertices, int numVertices, const GLuint* pIndices, int numIndices);
+	static void Free(GeometryRange& range);			// The range is left empty
+
+	static void Bind(VertexFormat format);			// Binds the format's VAO
+	static GLsizei GetVertexSize(VertexFormat format);
+
+	static GeometryArenaStats GetStats();
+};
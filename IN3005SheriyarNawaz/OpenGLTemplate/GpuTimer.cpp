@@ -0,0 +1,180 @@
+#include "GpuTimer.h"
+
+// Weight of the newest frame in the smoothed times, so the overlay is readable rather than flickering
+static const double SMOOTHING = 0.1;
+
+static const char* s_passNames[NUM_GPU_PASSES] = {
+	"Skybox", "Terrain", "Car", "Coins", "Tyres", "Lights", "Track", "HUD"
+};
+
+CGpuTimer::CGpuTimer()
+{
+	m_currentSet = 0;
+	m_inFrame = false;
+	m_supported = false;
+	m_frameTime = 0.0;
+	for (int i = 0; i < NUM_GPU_PASSES; i++)
+		m_passTimes[i] = 0.0;
+	m_droppedFrames = 0;
+	m_pTrack = NULL;
+	m_cpuSync = 0;
+	m_gpuSync = 0;
+	m_framesSinceSync = 0;
+}
+
+CGpuTimer::~CGpuTimer()
+{
+}
+
+void CGpuTimer::Create()
+{
+	// Timer queries are core since OpenGL 3.3, but an implementation may still report a zero-bit counter
+	GLint counterBits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+	m_supported = counterBits > 0;
+	if (!m_supported)
+		return;
+
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+		glGenQueries(NUM_QUERIES, m_sets[i].queries);
+		m_sets[i].pending = false;
+	}
+	m_currentSet = FRAMES_IN_FLIGHT - 1;
+
+#if PROFILER_ENABLED
+	m_pTrack = CProfiler::CreateTrack("GPU");
+	SyncClocks();
+#endif
+}
+
+void CGpuTimer::Release()
+{
+	if (!m_supported)
+		return;
+
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+		glDeleteQueries(NUM_QUERIES, m_sets[i].queries);
+	m_supported = false;
+}
+
+void CGpuTimer::BeginFrame()
+{
+	if (!m_supported)
+		return;
+
+	m_currentSet = (m_currentSet + 1) % FRAMES_IN_FLIGHT;
+	QuerySet& set = m_sets[m_currentSet];
+
+	// Queries complete in the order they were issued, so once the last one of a frame is available they all are.  If it
+	// is still not ready the results are thrown away rather than waited for
+	if (set.pending) {
+		GLint available = 0;
+		glGetQueryObjectiv(set.queries[FRAME_END_QUERY], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+			ReadBack(set);
+		else
+			m_droppedFrames++;
+		set.pending = false;
+	}
+
+	for (int i = 0; i < NUM_GPU_PASSES; i++)
+		set.passTimed[i] = false;
+
+#if PROFILER_ENABLED
+	if (++m_framesSinceSync >= CLOCK_SYNC_INTERVAL)
+		SyncClocks();
+#endif
+
+	glQueryCounter(set.queries[FRAME_BEGIN_QUERY], GL_TIMESTAMP);
+	m_inFrame = true;
+}
+
+void CGpuTimer::EndFrame()
+{
+	if (!m_inFrame)
+		return;
+
+	QuerySet& set = m_sets[m_currentSet];
+	glQueryCounter(set.queries[FRAME_END_QUERY], GL_TIMESTAMP);
+	set.pending = true;
+	m_inFrame = false;
+}
+
+void CGpuTimer::BeginPass(GpuPass pass)
+{
+	if (!m_inFrame)
+		return;
+
+	glQueryCounter(m_sets[m_currentSet].queries[2 + 2 * pass], GL_TIMESTAMP);
+}
+
+void CGpuTimer::EndPass(GpuPass pass)
+{
+	if (!m_inFrame)
+		return;
+
+	QuerySet& set = m_sets[m_currentSet];
+	glQueryCounter(set.queries[3 + 2 * pass], GL_TIMESTAMP);
+	set.passTimed[pass] = true;
+}
+
+// Only called once the frame's last query is available, so none of these wait
+void CGpuTimer::ReadBack(QuerySet& set)
+{
+	GLuint64 frameBegin = 0, frameEnd = 0;
+	glGetQueryObjectui64v(set.queries[FRAME_BEGIN_QUERY], GL_QUERY_RESULT, &frameBegin);
+	glGetQueryObjectui64v(set.queries[FRAME_END_QUERY], GL_QUERY_RESULT, &frameEnd);
+	m_frameTime = glm::mix(m_frameTime, (frameEnd - frameBegin) / 1.0e6, SMOOTHING);
+
+	for (int i = 0; i < NUM_GPU_PASSES; i++) {
+		double passTime = 0.0;
+		if (set.passTimed[i]) {
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v(set.queries[2 + 2 * i], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(set.queries[3 + 2 * i], GL_QUERY_RESULT, &end);
+			passTime = (end - begin) / 1.0e6;
+
+#if PROFILER_ENABLED
+			int64_t start = m_cpuSync + CProfiler::NanosecondsToTicks((int64_t)begin - m_gpuSync);
+			CProfiler::Record(m_pTrack, s_passNames[i], start, start + CProfiler::NanosecondsToTicks((int64_t)(end - begin)));
+#endif
+		}
+		m_passTimes[i] = glm::mix(m_passTimes[i], passTime, SMOOTHING);
+	}
+}
+
+// GL_TIMESTAMP read with glGetInteger64v is the GPU time once the commands so far have been submitted, which pairs up
+// with the CPU time taken straight after it.  Getting it makes the CPU wait for the driver, so it is only done at the
+// start and then every CLOCK_SYNC_INTERVAL frames to follow any drift between the clocks.  Frames in between use the
+// query results alone
+void CGpuTimer::SyncClocks()
+{
+	glGetInteger64v(GL_TIMESTAMP, &m_gpuSync);
+	m_cpuSync = CProfiler::Now();
+	m_framesSinceSync = 0;
+}
+
+bool CGpuTimer::IsSupported() const
+{
+	return m_supported;
+}
+
+double CGpuTimer::GetFrameTime() const
+{
+	return m_frameTime;
+}
+
+double CGpuTimer::GetPassTime(GpuPass pass) const
+{
+	return m_passTimes[pass];
+}
+
+int CGpuTimer::GetDroppedFrames() const
+{
+	return m_droppedFrames;
+}
+
+const char* CGpuTimer::GetPassName(GpuPass pass)
+{
+	return s_passNames[pass];
+}
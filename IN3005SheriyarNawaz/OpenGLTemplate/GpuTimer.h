@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Common.h"
+#include "Profiler.h"
+#include <stdint.h>
+
+// Render passes timed on the GPU, in the order Game::Render draws them
+enum GpuPass
+{
+	GPU_PASS_SKYBOX,
+	GPU_PASS_TERRAIN,
+	GPU_PASS_CAR,
+	GPU_PASS_COINS,
+	GPU_PASS_TYRES,
+	GPU_PASS_LIGHTS,
+	GPU_PASS_TRACK,
+	GPU_PASS_HUD,
+	NUM_GPU_PASSES
+};
+
+// Times each render pass on the GPU with timestamp queries.  Each frame writes into its own set of queries from a ring,
+// and a set is only read back when the ring comes round to it again, FRAMES_IN_FLIGHT frames later, so reading the
+// results never waits for the GPU.  Timestamps are used rather than GL_TIME_ELAPSED because only one elapsed query can
+// be active at a time and the trace needs to know when each pass started, not just how long it took.
+class CGpuTimer
+{
+public:
+	static const int FRAMES_IN_FLIGHT = 4;
+
+	CGpuTimer();
+	~CGpuTimer();
+
+	void Create();							// Creates the queries.  Does nothing if the GPU has no timestamp counter
+	void Release();
+
+	void BeginFrame();						// Reads back the oldest frame in the ring, then starts timing this one
+	void EndFrame();
+	void BeginPass(GpuPass pass);
+	void EndPass(GpuPass pass);
+
+	bool IsSupported() const;
+	double GetFrameTime() const;			// ms from BeginFrame to EndFrame, smoothed over the last few frames
+	double GetPassTime(GpuPass pass) const;	// ms, smoothed the same way.  Zero for passes that drew nothing
+	int GetDroppedFrames() const;			// Frames whose results were not ready when their queries were reused
+	static const char* GetPassName(GpuPass pass);
+
+private:
+	static const int FRAME_BEGIN_QUERY = 0;
+	static const int FRAME_END_QUERY = 1;
+	static const int NUM_QUERIES = 2 + 2 * NUM_GPU_PASSES;	// Then a begin and an end query for each pass
+	static const int CLOCK_SYNC_INTERVAL = 1000;			// Frames between readings of the two clocks, to follow drift
+
+	// The queries for one frame
+	struct QuerySet
+	{
+		GLuint queries[NUM_QUERIES];
+		bool passTimed[NUM_GPU_PASSES];
+		bool pending;
+	};
+
+	void ReadBack(QuerySet& set);
+	void SyncClocks();
+
+	QuerySet m_sets[FRAMES_IN_FLIGHT];
+	int m_currentSet;
+	bool m_inFrame;
+	bool m_supported;
+	double m_frameTime;
+	double m_passTimes[NUM_GPU_PASSES];
+	int m_droppedFrames;
+	ProfileThreadLog* m_pTrack;				// "GPU" track in the trace export
+	int64_t m_cpuSync;						// CPU and GPU clocks read together, to place GPU timestamps on the profiler's timeline
+	GLint64 m_gpuSync;
+	int m_framesSinceSync;
+};
@@ -0,0 +1,88 @@
+/*
+ Headless race driver.  Builds the track model and placements, then steps CRaceSimulation as fast as the CPU allows with
+ a scripted driver, with no window, GL context or audio.  Each time the driver runs out of lives the race starts again.
+ Useful for soak testing the game rules and for timing them.
+
+ Not part of the Windows build (it has its own main).  On Linux, from this directory:
+
+   g++ -O2 -std=c++17 -pthread -I. -DPROFILER_ENABLED=0 HeadlessRace.cpp CatmullRom.cpp TrackPlacements.cpp
+       CollectibleSet.cpp TrackBroadphase.cpp RaceSimulation.cpp -o headless_race
+
+ The profiler is compiled out because a step here is only ~100 ns, so the zones around Step would dominate the timing.
+ Build with Profiler.cpp and without -DPROFILER_ENABLED=0 to record a trace of a short run instead.
+
+ Usage: headless_race [ticks]
+*/
+
+#include "CatmullRom.h"
+#include "TrackPlacements.h"
+#include "CollectibleSet.h"
+#include "TrackBroadphase.h"
+#include "RaceSimulation.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Full throttle, weaving from side to side every few seconds so the car runs through both coins and tyres
+static unsigned int ScriptedInputs(long long tick)
+{
+	long long period = 3 * CRaceSimulation::STEP_RATE;
+	unsigned int inputs = INPUT_ACCELERATE;
+	if ((tick / period) % 2 == 0)
+		inputs |= INPUT_TURN_LEFT;
+	else
+		inputs |= INPUT_TURN_RIGHT;
+	return inputs;
+}
+
+int main(int argc, char** argv)
+{
+	long long ticks = 10000000;
+	if (argc > 1)
+		ticks = atoll(argv[1]);
+
+	CCatmullRom track;
+	track.CreateCentreline();
+	track.CreateOffsetCurves();
+
+	CTrackPlacements placements;
+	placements.Create(&track);
+
+	CCollectibleSet coins, tyres;
+	CTrackBroadphase coinBroadphase, tyreBroadphase;
+	CTrackPlacements::LoadCollectibles(placements.GetCoins(), track.GetTrackLength(), &coins, &coinBroadphase);
+	CTrackPlacements::LoadCollectibles(placements.GetTyres(), track.GetTrackLength(), &tyres, &tyreBroadphase);
+
+	// Steps are run on this thread, so the simulation thread is never started
+	CRaceSimulation race;
+	race.Create(&track, &coins, &coinBroadphase, &tyres, &tyreBroadphase, NULL);
+
+	printf("Track length %.1f, %d coins, %d tyres\n", track.GetTrackLength(), coins.GetSize(), tyres.GetSize());
+
+	// The driver loses all its lives within a lap or two, and a finished race skips the collision tests, so every game
+	// over starts a new race.  That way every tick timed is a full step
+	const double step = CRaceSimulation::GetStepLength();
+	int racesFinished = 0;
+	long long raceStart = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (long long tick = 0; tick < ticks; tick++) {
+		if (race.IsGameOver()) {
+			race.Reset();
+			racesFinished++;
+			raceStart = tick;
+		}
+		race.SetInputs(ScriptedInputs(tick - raceStart));
+		race.Step(step);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	race.PublishSnapshot();
+	race.AcquireSnapshot();
+	const RaceSnapshot& snapshot = race.GetSnapshot();
+
+	printf("%lld ticks (%.1f s of racing) in %.3f s: %.2f million ticks/s\n", ticks, ticks * step / 1000.0, seconds,
+		ticks / seconds / 1.0e6);
+	printf("%d races finished.  Last race: lap %d, score %d, lives %d, coins collected %d%s\n", racesFinished, snapshot.lap,
+		snapshot.score, snapshot.lives, coins.GetNumCollected(), snapshot.gameOver ? ", game over" : "");
+
+	return 0;
+}
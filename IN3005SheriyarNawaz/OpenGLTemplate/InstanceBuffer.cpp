@@ -0,0 +1,108 @@
+#include "InstanceBuffer.h"
+
+#define BUFFER_OFFSET(i) ((char *)NULL + (i))
+
+CInstanceBuffer::CInstanceBuffer()
+{
+	m_vbo = 0;
+	m_numVisible = 0;
+	m_numChanged = 0;
+	m_uploads = 0;
+}
+
+CInstanceBuffer::~CInstanceBuffer()
+{
+}
+
+// Create the buffer and store the transforms.  All instances start visible.
+void CInstanceBuffer::Create(const vector<glm::mat4>& transforms)
+{
+	if (m_vbo == 0)
+		glGenBuffers(1, &m_vbo);
+
+	m_transforms = transforms;
+	m_visible.assign(transforms.size(), true);
+	m_uploaded.assign(transforms.size(), false);
+	m_numVisible = (int)transforms.size();
+	m_numChanged = (int)transforms.size();
+}
+
+// Hiding an instance (e.g. a collected coin) removes it from the packed buffer on the next Bind.  An instance that is
+// hidden and shown again before then, or a new view that happens to see the same set, does not cause an upload
+void CInstanceBuffer::SetVisible(int index, bool visible)
+{
+	if (index < 0 || index >= (int)m_visible.size() || m_visible[index] == visible)
+		return;
+
+	m_visible[index] = visible;
+	m_numVisible += visible ? 1 : -1;
+	m_numChanged += m_uploaded[index] == visible ? -1 : 1;
+}
+
+int CInstanceBuffer::GetNumInstances()
+{
+	return m_numVisible;
+}
+
+int CInstanceBuffer::GetUploads()
+{
+	return m_uploads;
+}
+
+// Pack the visible transforms together and send them to the GPU.  This only happens when the mask differs from the one
+// last uploaded.
+void CInstanceBuffer::UploadDataToGPU()
+{
+	m_visibleTransforms.clear();
+	m_visibleTransforms.reserve(m_numVisible);
+	for (size_t i = 0; i < m_transforms.size(); i++) {
+		if (m_visible[i])
+			m_visibleTransforms.push_back(m_transforms[i]);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	if (m_visibleTransforms.empty())
+		glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
+	else
+		glBufferData(GL_ARRAY_BUFFER, m_visibleTransforms.size() * sizeof(glm::mat4), &m_visibleTransforms[0], GL_DYNAMIC_DRAW);
+	m_uploaded = m_visible;
+	m_numChanged = 0;
+	m_uploads++;
+}
+
+// Bind the buffer and point attributes 3 to 6 (one per matrix column) at it, advancing once per instance.
+// The attribute setup is stored in whichever VAO is bound, so call this after binding the object's VAO.
+void CInstanceBuffer::Bind()
+{
+	if (m_numChanged > 0)
+		UploadDataToGPU();
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	for (int i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), BUFFER_OFFSET(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + i, 1);
+	}
+}
+
+// Disable attributes 3 to 6 after an instanced draw.  The VAO belongs to the geometry arena and is shared with meshes
+// drawn one at a time, which must not see the instance attributes left on
+void CInstanceBuffer::Unbind()
+{
+	for (int i = 0; i < 4; i++)
+		glDisableVertexAttribArray(3 + i);
+}
+
+// Release the buffer and the CPU side data
+void CInstanceBuffer::Release()
+{
+	if (m_vbo != 0)
+		glDeleteBuffers(1, &m_vbo);
+	m_vbo = 0;
+	m_transforms.clear();
+	m_visible.clear();
+	m_uploaded.clear();
+	m_visibleTransforms.clear();
+	m_numVisible = 0;
+	m_numChanged = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Common.h"
+
+// This class holds a per-instance transform for each copy of an object and uploads the visible ones to a
+// vertex buffer, so that the whole set can be drawn with a single instanced draw call.
+// The transforms are fed to the shader as a mat4 vertex attribute in locations 3 to 6.
+class CInstanceBuffer
+{
+public:
+	CInstanceBuffer();
+	~CInstanceBuffer();
+
+	void Create(const vector<glm::mat4>& transforms);	// Creates the buffer with every instance visible
+	void SetVisible(int index, bool visible);			// Shows or hides one instance
+	void Bind();										// Binds the buffer and sets up the instance attributes in the current VAO
+	void Unbind();										// Turns the instance attributes off again in the current VAO, which other meshes share
+	void Release();										// Releases the buffer
+
+	int GetNumInstances();								// Number of visible instances to draw
+	int GetUploads();									// Times the visible set changed and was sent to the GPU
+
+private:
+	void UploadDataToGPU();
+
+	UINT m_vbo;											// VBO id
+	vector<glm::mat4> m_transforms;						// World transform of every instance
+	vector<bool> m_visible;								// Visibility mask, one entry per instance
+	vector<bool> m_uploaded;							// The mask as it was at the last upload
+	vector<glm::mat4> m_visibleTransforms;				// Packed transforms of the visible instances
+	int m_numVisible;
+	int m_numChanged;									// Entries of the mask that differ from m_uploaded
+	int m_uploads;
+};
@@ -0,0 +1,226 @@
+#include "LightClusters.h"
+#include "GLStateCache.h"
+
+CLightClusters::CLightClusters()
+{
+	m_screenWidth = m_screenHeight = 0;
+	m_tileSize = 0;
+	m_tilesX = m_tilesY = m_numSlices = 0;
+	m_zNear = m_zFar = 0.0f;
+	m_sliceScale = 0.0f;
+	m_lightDataBuffer = m_lightDataTexture = 0;
+	m_clusterGridBuffer = m_clusterGridTexture = 0;
+	m_lightIndexBuffer = m_lightIndexTexture = 0;
+	m_maxLightsPerCluster = 0;
+}
+
+CLightClusters::~CLightClusters()
+{
+}
+
+// Set up the cluster grid for a screen size and depth range, and create the texture buffers
+void CLightClusters::Create(int screenWidth, int screenHeight, int tileSize, int numSlices, float zNear, float zFar)
+{
+	m_screenWidth = screenWidth;
+	m_screenHeight = screenHeight;
+	m_tileSize = tileSize;
+	m_tilesX = (screenWidth + tileSize - 1) / tileSize;
+	m_tilesY = (screenHeight + tileSize - 1) / tileSize;
+	m_numSlices = numSlices;
+	m_zNear = zNear;
+	m_zFar = zFar;
+	m_sliceScale = numSlices / logf(zFar / zNear);
+
+	CreateTextureBuffer(m_lightDataBuffer, m_lightDataTexture, GL_RGBA32F);
+	CreateTextureBuffer(m_clusterGridBuffer, m_clusterGridTexture, GL_RG32UI);
+	CreateTextureBuffer(m_lightIndexBuffer, m_lightIndexTexture, GL_R32UI);
+
+	m_clusterGrid.assign(m_tilesX * m_tilesY * m_numSlices * 2, 0);
+}
+
+void CLightClusters::CreateTextureBuffer(UINT& buffer, UINT& texture, GLenum internalFormat)
+{
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_DYNAMIC_DRAW);
+
+	glGenTextures(1, &texture);
+	CGLStateCache::BindTexture(0, GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+	CGLStateCache::BindTexture(0, GL_TEXTURE_BUFFER, 0);
+}
+
+// Replace the contents of a texture buffer.  Buffers can't be empty, so at least one element is always sent
+void CLightClusters::UploadTextureBuffer(UINT buffer, const void* ptrData, UINT dataSize)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	if (dataSize == 0)
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_DYNAMIC_DRAW);
+	else
+		glBufferData(GL_TEXTURE_BUFFER, dataSize, ptrData, GL_DYNAMIC_DRAW);
+}
+
+// Work out which clusters a light's sphere of influence overlaps.  Returns false if it is outside the view volume.
+// The screen range comes from projecting the corners of the sphere's view-space bounding box, which is conservative.
+bool CLightClusters::FindClusterRange(const glm::vec3& centre, float radius, const glm::mat4& projMatrix, glm::ivec3& minCluster, glm::ivec3& maxCluster)
+{
+	// Depth is measured along -z in eye coordinates
+	float nearDepth = -centre.z - radius;
+	float farDepth = -centre.z + radius;
+	if (farDepth < m_zNear || nearDepth > m_zFar)
+		return false;
+
+	nearDepth = glm::max(nearDepth, m_zNear);
+	farDepth = glm::min(farDepth, m_zFar);
+	minCluster.z = glm::clamp((int)(logf(nearDepth / m_zNear) * m_sliceScale), 0, m_numSlices - 1);
+	maxCluster.z = glm::clamp((int)(logf(farDepth / m_zNear) * m_sliceScale), 0, m_numSlices - 1);
+
+	// A sphere that crosses the near plane can cover any part of the screen
+	if (-centre.z - radius <= m_zNear) {
+		minCluster.x = 0;
+		minCluster.y = 0;
+		maxCluster.x = m_tilesX - 1;
+		maxCluster.y = m_tilesY - 1;
+		return true;
+	}
+
+	glm::vec2 ndcMin(1.0f), ndcMax(-1.0f);
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner = centre + glm::vec3((i & 1) ? radius : -radius, (i & 2) ? radius : -radius, (i & 4) ? radius : -radius);
+		glm::vec4 clip = projMatrix * glm::vec4(corner, 1.0f);
+		glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+		return false;
+
+	// NDC to pixels to tiles.  Tile rows count up from the bottom of the screen, like gl_FragCoord
+	minCluster.x = glm::clamp((int)((ndcMin.x * 0.5f + 0.5f) * m_screenWidth) / m_tileSize, 0, m_tilesX - 1);
+	maxCluster.x = glm::clamp((int)((ndcMax.x * 0.5f + 0.5f) * m_screenWidth) / m_tileSize, 0, m_tilesX - 1);
+	minCluster.y = glm::clamp((int)((ndcMin.y * 0.5f + 0.5f) * m_screenHeight) / m_tileSize, 0, m_tilesY - 1);
+	maxCluster.y = glm::clamp((int)((ndcMax.y * 0.5f + 0.5f) * m_screenHeight) / m_tileSize, 0, m_tilesY - 1);
+	return true;
+}
+
+// Bin the lights into clusters and upload the light data, the per-cluster (offset, count) grid and the
+// packed light index list.  Counting first and then filling keeps the index list in one contiguous array.
+void CLightClusters::Update(const vector<ClusteredLight>& lights, float lightRadius, const glm::mat4& projMatrix)
+{
+	int numLights = (int)lights.size();
+	int numClusters = m_tilesX * m_tilesY * m_numSlices;
+
+	m_lightRanges.resize(numLights * 2);
+	m_lightVisible.resize(numLights);
+	m_clusterGrid.assign(numClusters * 2, 0);
+
+	// Count how many lights touch each cluster
+	for (int i = 0; i < numLights; i++) {
+		glm::ivec3& minCluster = m_lightRanges[i * 2];
+		glm::ivec3& maxCluster = m_lightRanges[i * 2 + 1];
+		m_lightVisible[i] = FindClusterRange(glm::vec3(lights[i].position), lightRadius, projMatrix, minCluster, maxCluster);
+		if (!m_lightVisible[i])
+			continue;
+
+		for (int z = minCluster.z; z <= maxCluster.z; z++)
+			for (int y = minCluster.y; y <= maxCluster.y; y++)
+				for (int x = minCluster.x; x <= maxCluster.x; x++)
+					m_clusterGrid[((z * m_tilesY + y) * m_tilesX + x) * 2 + 1]++;
+	}
+
+	// Turn the counts into offsets
+	GLuint offset = 0;
+	m_maxLightsPerCluster = 0;
+	for (int c = 0; c < numClusters; c++) {
+		GLuint count = m_clusterGrid[c * 2 + 1];
+		m_clusterGrid[c * 2] = offset;
+		m_clusterGrid[c * 2 + 1] = 0;
+		offset += count;
+		m_maxLightsPerCluster = glm::max(m_maxLightsPerCluster, (int)count);
+	}
+
+	// Fill in the index list
+	m_lightIndices.resize(offset);
+	for (int i = 0; i < numLights; i++) {
+		if (!m_lightVisible[i])
+			continue;
+
+		const glm::ivec3& minCluster = m_lightRanges[i * 2];
+		const glm::ivec3& maxCluster = m_lightRanges[i * 2 + 1];
+		for (int z = minCluster.z; z <= maxCluster.z; z++)
+			for (int y = minCluster.y; y <= maxCluster.y; y++)
+				for (int x = minCluster.x; x <= maxCluster.x; x++) {
+					GLuint* cluster = &m_clusterGrid[((z * m_tilesY + y) * m_tilesX + x) * 2];
+					m_lightIndices[cluster[0] + cluster[1]] = (GLuint)i;
+					cluster[1]++;
+				}
+	}
+
+	UploadTextureBuffer(m_lightDataBuffer, numLights > 0 ? &lights[0] : NULL, numLights * sizeof(ClusteredLight));
+	UploadTextureBuffer(m_clusterGridBuffer, &m_clusterGrid[0], m_clusterGrid.size() * sizeof(GLuint));
+	UploadTextureBuffer(m_lightIndexBuffer, m_lightIndices.empty() ? NULL : &m_lightIndices[0], m_lightIndices.size() * sizeof(GLuint));
+}
+
+// Bind the texture buffers to the units the main shader samples them from
+void CLightClusters::Bind()
+{
+	CGLStateCache::BindTexture(LIGHT_DATA_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_lightDataTexture);
+	CGLStateCache::BindTexture(CLUSTER_GRID_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_clusterGridTexture);
+	CGLStateCache::BindTexture(LIGHT_INDEX_TEXTURE_UNIT, GL_TEXTURE_BUFFER, m_lightIndexTexture);
+}
+
+void CLightClusters::Release()
+{
+	CGLStateCache::DeleteTexture(m_lightDataTexture);
+	CGLStateCache::DeleteTexture(m_clusterGridTexture);
+	CGLStateCache::DeleteTexture(m_lightIndexTexture);
+	glDeleteBuffers(1, &m_lightDataBuffer);
+	glDeleteBuffers(1, &m_clusterGridBuffer);
+	glDeleteBuffers(1, &m_lightIndexBuffer);
+}
+
+glm::ivec4 CLightClusters::GetDimensions()
+{
+	return glm::ivec4(m_tilesX, m_tilesY, m_numSlices, m_tileSize);
+}
+
+glm::vec4 CLightClusters::GetDepthParameters()
+{
+	return glm::vec4(m_zNear, m_sliceScale, 0.0f, 0.0f);
+}
+
+int CLightClusters::GetNumLightIndices()
+{
+	return (int)m_lightIndices.size();
+}
+
+int CLightClusters::GetMaxLightsPerCluster()
+{
+	return m_maxLightsPerCluster;
+}
+
+// The same sums as ClusterIndex in mainShader.frag.  depth is measured along -z in eye coordinates
+int CLightClusters::FindCluster(const glm::vec2& fragCoord, float depth)
+{
+	int tileX = glm::clamp((int)fragCoord.x / m_tileSize, 0, m_tilesX - 1);
+	int tileY = glm::clamp((int)fragCoord.y / m_tileSize, 0, m_tilesY - 1);
+	depth = glm::max(depth, m_zNear);
+	int slice = glm::clamp((int)(logf(depth / m_zNear) * m_sliceScale), 0, m_numSlices - 1);
+	return (slice * m_tilesY + tileY) * m_tilesX + tileX;
+}
+
+int CLightClusters::GetNumLightsInCluster(int cluster)
+{
+	return (int)m_clusterGrid[cluster * 2 + 1];
+}
+
+bool CLightClusters::IsLightInCluster(int cluster, int light)
+{
+	GLuint offset = m_clusterGrid[cluster * 2];
+	GLuint count = m_clusterGrid[cluster * 2 + 1];
+	for (GLuint i = 0; i < count; i++)
+		if (m_lightIndices[offset + i] == (GLuint)light)
+			return true;
+	return false;
+}
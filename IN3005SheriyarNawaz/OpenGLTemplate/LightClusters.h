@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Common.h"
+
+// A spotlight as the clustered lighting pass stores it: five RGBA32F texels per light in a texture buffer.
+// Positions and directions are in eye coordinates.
+struct ClusteredLight
+{
+	glm::vec4 position;		// xyz = position, w = spotlight exponent
+	glm::vec4 direction;	// xyz = direction, w = cutoff
+	glm::vec4 La;			// rgb
+	glm::vec4 Ld;			// rgb
+	glm::vec4 Ls;			// rgb
+};
+
+// Texture units used by the cluster data.  0 and 1 are taken by sampler0 and the cube map
+#define LIGHT_DATA_TEXTURE_UNIT 2
+#define CLUSTER_GRID_TEXTURE_UNIT 3
+#define LIGHT_INDEX_TEXTURE_UNIT 4
+
+// Bins lights into a grid of view-space clusters (screen tiles, each split into exponentially spaced depth
+// slices) so that a fragment only has to evaluate the lights that can reach its cluster.  The binning is done
+// on the CPU every frame; the results are stored in texture buffers since the GL 4.0 context has no SSBOs.
+class CLightClusters
+{
+public:
+	CLightClusters();
+	~CLightClusters();
+
+	void Create(int screenWidth, int screenHeight, int tileSize, int numSlices, float zNear, float zFar);
+	void Update(const vector<ClusteredLight>& lights, float lightRadius, const glm::mat4& projMatrix);	// Bins the lights and uploads the results
+	void Bind();											// Binds the three texture buffers to their texture units
+	void Release();
+
+	glm::ivec4 GetDimensions();								// x, y = tiles, z = slices, w = tile size in pixels
+	glm::vec4 GetDepthParameters();							// x = near plane, y = slices per unit of log depth
+	int GetNumLightIndices();								// Total number of light references across all clusters
+	int GetMaxLightsPerCluster();
+	int FindCluster(const glm::vec2& fragCoord, float depth);	// The cluster a fragment falls into, as ClusterIndex in mainShader.frag
+	int GetNumLightsInCluster(int cluster);					// From the last Update
+	bool IsLightInCluster(int cluster, int light);
+
+private:
+	void CreateTextureBuffer(UINT& buffer, UINT& texture, GLenum internalFormat);
+	void UploadTextureBuffer(UINT buffer, const void* ptrData, UINT dataSize);
+	bool FindClusterRange(const glm::vec3& centre, float radius, const glm::mat4& projMatrix, glm::ivec3& minCluster, glm::ivec3& maxCluster);
+
+	int m_screenWidth, m_screenHeight;
+	int m_tileSize;
+	int m_tilesX, m_tilesY, m_numSlices;
+	float m_zNear, m_zFar;
+	float m_sliceScale;										// numSlices / log(zFar / zNear)
+
+	UINT m_lightDataBuffer, m_lightDataTexture;
+	UINT m_clusterGridBuffer, m_clusterGridTexture;
+	UINT m_lightIndexBuffer, m_lightIndexTexture;
+
+	vector<glm::ivec3> m_lightRanges;						// min and max cluster of each light, two entries per light
+	vector<bool> m_lightVisible;
+	vector<GLuint> m_clusterGrid;							// (offset, count) per cluster
+	vector<GLuint> m_lightIndices;
+	int m_maxLightsPerCluster;
+};
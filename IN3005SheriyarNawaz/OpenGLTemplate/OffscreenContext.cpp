@@ -0,0 +1,131 @@
+#include "OffscreenContext.h"
+#include <EGL/eglext.h>
+
+COffscreenContext::COffscreenContext()
+{
+	m_display = EGL_NO_DISPLAY;
+	m_context = EGL_NO_CONTEXT;
+	m_fbo = 0;
+	m_colourBuffer = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+COffscreenContext::~COffscreenContext()
+{
+	Release();
+}
+
+// The surfaceless platform needs no X server or DRM device.  Drivers without it fall back to the default display
+EGLDisplay COffscreenContext::GetSurfacelessDisplay()
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != NULL) {
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display != EGL_NO_DISPLAY)
+			return display;
+	}
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool COffscreenContext::Create(int width, int height)
+{
+	int majorVersion = 4;
+	int minorVersion = 0;
+
+	m_display = GetSurfacelessDisplay();
+	if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, NULL, NULL)) {
+		fprintf(stderr, "Couldn't initialise EGL (error 0x%x)\n", eglGetError());
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		fprintf(stderr, "EGL has no desktop OpenGL\n");
+		return false;
+	}
+
+	// Only the context matters, since nothing is drawn to an EGL surface
+	const EGLint configAttribs[] =
+	{
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_SURFACE_TYPE, 0,
+		EGL_NONE
+	};
+	const EGLint contextAttribs[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+		EGL_CONTEXT_MINOR_VERSION, minorVersion,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(m_display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+		config = (EGLConfig)0;	// EGL_KHR_no_config_context
+
+	m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (m_context == EGL_NO_CONTEXT || !eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+		fprintf(stderr, "OpenGL %d.%d is not supported without a display (error 0x%x)\n", majorVersion, minorVersion, eglGetError());
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	CreateFramebuffer();
+
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+// Colour and depth renderbuffers matching the pixel format GameWindow asks WGL for
+void COffscreenContext::CreateFramebuffer()
+{
+	glGenRenderbuffers(1, &m_colourBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colourBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+
+	glGenFramebuffers(1, &m_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colourBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	glViewport(0, 0, m_width, m_height);
+}
+
+void COffscreenContext::Release()
+{
+	if (m_context != EGL_NO_CONTEXT) {
+		glDeleteFramebuffers(1, &m_fbo);
+		glDeleteRenderbuffers(1, &m_colourBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_fbo = m_colourBuffer = m_depthBuffer = 0;
+
+		eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(m_display, m_context);
+		m_context = EGL_NO_CONTEXT;
+	}
+	if (m_display != EGL_NO_DISPLAY) {
+		eglTerminate(m_display);
+		m_display = EGL_NO_DISPLAY;
+	}
+}
+
+int COffscreenContext::GetWidth() const
+{
+	return m_width;
+}
+
+int COffscreenContext::GetHeight() const
+{
+	return m_height;
+}
+
+const char* COffscreenContext::GetRenderer() const
+{
+	return (const char*)glGetString(GL_RENDERER);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common.h"
+#include <EGL/egl.h>
+
+// An OpenGL 4.0 core context with no window, for rendering on machines without a display.  It is created through EGL
+// on a surfaceless display (Mesa's llvmpipe on a build machine, or a GPU driver that supports it).  With no window
+// there is no default framebuffer, so Create also makes a framebuffer object of the requested size and binds it in
+// its place.  Stands in for GameWindow's WGL context in the offscreen benchmark.
+class COffscreenContext
+{
+public:
+	COffscreenContext();
+	~COffscreenContext();
+
+	bool Create(int width, int height);
+	void Release();
+
+	int GetWidth() const;
+	int GetHeight() const;
+	const char* GetRenderer() const;	// GL_RENDERER string, to say what the numbers were measured on
+
+private:
+	EGLDisplay GetSurfacelessDisplay();
+	void CreateFramebuffer();
+
+	EGLDisplay m_display;
+	EGLContext m_context;
+
+	GLuint m_fbo;
+	GLuint m_colourBuffer;
+	GLuint m_depthBuffer;
+	int m_width;
+	int m_height;
+};
@@ -23,37 +23,26 @@
 
 COpenAssetImportMesh::MeshEntry::MeshEntry()
 {
-    vbo = INVALID_OGL_VALUE;
-    ibo = INVALID_OGL_VALUE;
     NumIndices  = 0;
     MaterialIndex = INVALID_MATERIAL;
 };
 
+// The range is freed by COpenAssetImportMesh::Clear, not here, as entries are copied about inside the vector
 COpenAssetImportMesh::MeshEntry::~MeshEntry()
 {
-    if (vbo != INVALID_OGL_VALUE)
-        glDeleteBuffers(1, &vbo);
-
-    if (ibo != INVALID_OGL_VALUE)
-        glDeleteBuffers(1, &ibo);
 }
 
+// Vertex has the same layout as MeshVertex, so the vertices go into the arena as they are
 void COpenAssetImportMesh::MeshEntry::Init(const std::vector<Vertex>& Vertices,
                           const std::vector<unsigned int>& Indices)
 {
     NumIndices = Indices.size();
-
-	glGenBuffers(1, &vbo);
-  	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
-
-    glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * NumIndices, &Indices[0], GL_STATIC_DRAW);
+    Range = CGeometryArena::Allocate(VERTEX_FORMAT_MESH, &Vertices[0], (int)Vertices.size(), &Indices[0], (int)NumIndices);
 }
 
 COpenAssetImportMesh::COpenAssetImportMesh()
 {
+    m_boundingRadius = 0.0f;
 }
 
 
@@ -68,7 +57,10 @@ void COpenAssetImportMesh::Clear()
     for (unsigned int i = 0 ; i < m_Textures.size() ; i++) {
         SAFE_DELETE(m_Textures[i]);
     }
-	glDeleteVertexArrays(1, &m_vao);
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        CGeometryArena::Free(m_Entries[i].Range);
+    }
+    m_Entries.clear();
 }
 
 
@@ -97,10 +89,6 @@ bool COpenAssetImportMesh::InitFromScene(const aiScene* pScene, const std::strin
     m_Entries.resize(pScene->mNumMeshes);
     m_Textures.resize(pScene->mNumMaterials);
 
-	glGenVertexArrays(1, &m_vao); 
-	glBindVertexArray(m_vao);
-
-
     // Initialize the meshes in the scene one by one
     for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
         const aiMesh* paiMesh = pScene->mMeshes[i];
@@ -129,6 +117,7 @@ void COpenAssetImportMesh::InitMesh(unsigned int Index, const aiMesh* paiMesh)
                  glm::vec3(pNormal->x, pNormal->y, pNormal->z));
 
         Vertices.push_back(v);
+        m_boundingRadius = glm::max(m_boundingRadius, glm::length(v.m_pos));
     }
 
     for (unsigned int i = 0 ; i < paiMesh->mNumFaces ; i++) {
@@ -205,21 +194,10 @@ bool COpenAssetImportMesh::InitMaterials(const aiScene* pScene, const std::strin
 
 void COpenAssetImportMesh::Render()
 {
-	glBindVertexArray(m_vao);
+	CGeometryArena::Bind(VERTEX_FORMAT_MESH);
 
     for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, m_Entries[i].vbo);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)12);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)20);
-
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Entries[i].ibo);
-
-
+        const GeometryRange& Range = m_Entries[i].Range;
         const unsigned int MaterialIndex = m_Entries[i].MaterialIndex;
 
         if (MaterialIndex < m_Textures.size() && m_Textures[MaterialIndex]) {
@@ -227,12 +205,35 @@ void COpenAssetImportMesh::Render()
         }
 
 
-        glDrawElements(GL_TRIANGLES, m_Entries[i].NumIndices, GL_UNSIGNED_INT, 0);
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+        glDrawElementsBaseVertex(GL_TRIANGLES, m_Entries[i].NumIndices, GL_UNSIGNED_INT, Range.GetIndexOffset(), Range.baseVertex);
     }
+}
 
+// Radius of a sphere around the model origin that contains every vertex
+float COpenAssetImportMesh::GetBoundingRadius()
+{
+    return m_boundingRadius;
+}
+
+// Same as Render, but draws every visible instance of each mesh entry with one call
+void COpenAssetImportMesh::RenderInstanced(CInstanceBuffer* pInstances)
+{
+	if (pInstances->GetNumInstances() == 0)
+		return;
+
+	CGeometryArena::Bind(VERTEX_FORMAT_MESH);
+	pInstances->Bind();
+
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        const GeometryRange& Range = m_Entries[i].Range;
+        const unsigned int MaterialIndex = m_Entries[i].MaterialIndex;
 
+        if (MaterialIndex < m_Textures.size() && m_Textures[MaterialIndex]) {
+            m_Textures[MaterialIndex]->Bind(0);
+        }
 
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_Entries[i].NumIndices, GL_UNSIGNED_INT, Range.GetIndexOffset(),
+            pInstances->GetNumInstances(), Range.baseVertex);
+    }
+	pInstances->Unbind();
 }
@@ -29,6 +29,8 @@
 
 #include "Common.h"
 #include "Texture.h"
+#include "InstanceBuffer.h"
+#include "GeometryArena.h"
 
 #define INVALID_OGL_VALUE 0xFFFFFFFF
 #define SAFE_DELETE(p) if (p) { delete p; p = NULL; }
@@ -58,6 +60,8 @@ public:
     ~COpenAssetImportMesh();
     bool Load(const std::string& Filename);
     void Render();
+    void RenderInstanced(CInstanceBuffer* pInstances);
+    float GetBoundingRadius();
 
 private:
     bool InitFromScene(const aiScene* pScene, const std::string& Filename);
@@ -75,15 +79,14 @@ private:
 
         void Init(const std::vector<Vertex>& Vertices,
                   const std::vector<unsigned int>& Indices);
-        GLuint vbo;
-        GLuint ibo;
+        GeometryRange Range;
         unsigned int NumIndices;
         unsigned int MaterialIndex;
     };
 
     std::vector<MeshEntry> m_Entries;
     std::vector<CTexture*> m_Textures;
-	GLuint m_vao;
+	float m_boundingRadius;
 };
 
 
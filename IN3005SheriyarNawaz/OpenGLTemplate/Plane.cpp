@@ -30,14 +30,6 @@ void CPlane::Create(string directory, string filename, float width, float height
 	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
 	
 
-	// Use VAO to store state associated with vertices
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
-
-	// Create a VBO
-	m_vbo.Create();
-	m_vbo.Bind();
-
 	float halfWidth = m_width / 2.0f;
 	float halfHeight = m_height / 2.0f;
 
@@ -63,44 +55,31 @@ void CPlane::Create(string directory, string filename, float width, float height
 	glm::vec3 planeNormal = glm::vec3(0.0f, 1.0f, 0.0f);
 
 	// Put the vertex attributes in the VBO
-	for (unsigned int i = 0; i < 4; i++) {
-		m_vbo.AddData(&planeVertices[i], sizeof(glm::vec3));
-		m_vbo.AddData(&planeTexCoords[i], sizeof(glm::vec2));
-		m_vbo.AddData(&planeNormal, sizeof(glm::vec3));
-	}
-
-
-	// Upload the VBO to the GPU
-	m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
+	m_vbo.Create();
+	m_vbo.Reserve(4, 6);
+	for (unsigned int i = 0; i < 4; i++)
+		m_vbo.AddVertex(MeshVertex(planeVertices[i], planeTexCoords[i], planeNormal));
 
-	// Set the vertex attribute locations
-	GLsizei istride = 2*sizeof(glm::vec3)+sizeof(glm::vec2);
+	// Two triangles, wound as the triangle strip the plane used to be drawn with
+	m_vbo.AddTriangle(0, 1, 2);
+	m_vbo.AddTriangle(2, 1, 3);
+	m_vbo.UploadDataToGPU();
 
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, istride, 0);
-	// Texture coordinates
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, istride, (void*)sizeof(glm::vec3));
-	// Normal vectors
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, istride, (void*)(sizeof(glm::vec3)+sizeof(glm::vec2)));
-	
+	m_drawList.Create();
+	m_drawList.Add(m_vbo.GetRange());
 }
 
-// Render the plane as a triangle strip
+// Render the plane.  Its draw list never changes, so the command is only uploaded the first time
 void CPlane::Render()
 {
-	glBindVertexArray(m_vao);
 	m_texture.Bind();
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	
+	m_drawList.Render();
 }
 
 // Release resources
 void CPlane::Release()
 {
 	m_texture.Release();
-	glDeleteVertexArrays(1, &m_vao);
+	m_drawList.Release();
 	m_vbo.Release();
 }
\ No newline at end of file
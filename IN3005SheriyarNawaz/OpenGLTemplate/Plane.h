@@ -1,7 +1,8 @@
 #pragma once
 
 #include "Texture.h"
-#include "VertexBufferObject.h"
+#include "VertexBufferObjectIndexed.h"
+#include "SceneDrawList.h"
 
 // Class for generating a xz plane of a given size
 class CPlane
@@ -13,8 +14,8 @@ public:
 	void Render();
 	void Release();
 private:
-	UINT m_vao;
-	CVertexBufferObject m_vbo;
+	CVertexBufferObjectIndexed m_vbo;
+	CSceneDrawList m_drawList;
 	CTexture m_texture;
 	string m_directory;
 	string m_filename;
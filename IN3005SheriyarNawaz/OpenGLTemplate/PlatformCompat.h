@@ -0,0 +1,30 @@
+#pragma once
+
+// The parts of the Windows API that the rendering classes use, for building them elsewhere.  Only included by
+// Common.h when _WIN32 is not defined
+#include <stdio.h>
+
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+
+#define TRUE 1
+#define FALSE 0
+
+#define MB_ICONHAND 0x10
+#define MB_ICONERROR MB_ICONHAND
+
+// There is no one to click OK, so errors go to stderr
+inline int MessageBox(void*, const char* text, const char* caption, unsigned int)
+{
+	fprintf(stderr, "%s: %s\n", caption, text);
+	return 0;
+}
+
+// Only the array forms are used, where MSVC takes the size from the array
+#define sprintf_s(buffer, ...) snprintf(buffer, sizeof(buffer), __VA_ARGS__)
+
+inline int fopen_s(FILE** file, const char* filename, const char* mode)
+{
+	*file = fopen(filename, mode);
+	return *file == NULL;
+}
@@ -0,0 +1,119 @@
+#include "Profiler.h"
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+
+// Every thread's ring, so the trace can be written from any thread.  Rings are never freed, so zones recorded by a
+// thread that has since finished are still in the trace
+static std::mutex s_logsMutex;
+static vector<ProfileThreadLog*> s_logs;
+static thread_local ProfileThreadLog* s_pThreadLog = NULL;
+
+static const int64_t s_startTime = std::chrono::steady_clock::now().time_since_epoch().count();
+
+int64_t CProfiler::Now()
+{
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+int64_t CProfiler::NanosecondsToTicks(int64_t nanoseconds)
+{
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(nanoseconds)).count();
+}
+
+ProfileThreadLog* CProfiler::CreateLog()
+{
+	ProfileThreadLog* pLog = new ProfileThreadLog;
+	pLog->count = 0;
+
+	std::lock_guard<std::mutex> lock(s_logsMutex);
+	pLog->threadId = (int)s_logs.size() + 1;
+	s_logs.push_back(pLog);
+	return pLog;
+}
+
+ProfileThreadLog* CProfiler::GetThreadLog()
+{
+	if (s_pThreadLog == NULL)
+		s_pThreadLog = CreateLog();
+	return s_pThreadLog;
+}
+
+ProfileThreadLog* CProfiler::CreateTrack(const char* name)
+{
+	ProfileThreadLog* pLog = CreateLog();
+	std::lock_guard<std::mutex> lock(s_logsMutex);
+	pLog->threadName = name;
+	return pLog;
+}
+
+void CProfiler::Record(const char* name, int64_t start, int64_t end)
+{
+	Record(GetThreadLog(), name, start, end);
+}
+
+void CProfiler::Record(ProfileThreadLog* pLog, const char* name, int64_t start, int64_t end)
+{
+	uint64_t count = pLog->count.load(std::memory_order_relaxed);
+
+	ProfileEvent& event = pLog->events[count % ProfileThreadLog::CAPACITY];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	pLog->count.store(count + 1, std::memory_order_release);
+}
+
+void CProfiler::SetThreadName(const char* name)
+{
+	ProfileThreadLog* pLog = GetThreadLog();
+	std::lock_guard<std::mutex> lock(s_logsMutex);
+	pLog->threadName = name;
+}
+
+// Complete ("X") events with microsecond timestamps from when the program started, plus a thread_name metadata event
+// per thread
+bool CProfiler::WriteChromeTrace(const string& filename)
+{
+	FILE* pFile = fopen(filename.c_str(), "w");
+	if (pFile == NULL)
+		return false;
+
+	const double ticksToMicroseconds = 1.0e6 * std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
+	bool first = true;
+
+	fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	std::lock_guard<std::mutex> lock(s_logsMutex);
+	for (size_t t = 0; t < s_logs.size(); t++) {
+		ProfileThreadLog* pLog = s_logs[t];
+		if (!pLog->threadName.empty()) {
+			fprintf(pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",\n", pLog->threadId, pLog->threadName.c_str());
+			first = false;
+		}
+
+		// Copy what is in the ring, then drop anything the owning thread may have overwritten while it was being copied
+		uint64_t end = pLog->count.load(std::memory_order_acquire);
+		uint64_t begin = end > (uint64_t)ProfileThreadLog::CAPACITY ? end - ProfileThreadLog::CAPACITY : 0;
+		vector<ProfileEvent> events;
+		events.reserve((size_t)(end - begin));
+		for (uint64_t i = begin; i < end; i++)
+			events.push_back(pLog->events[i % ProfileThreadLog::CAPACITY]);
+
+		// The owner may already be writing event number after, into the slot of event after - CAPACITY, so that goes too
+		uint64_t after = pLog->count.load(std::memory_order_acquire);
+		uint64_t valid = after + 1 > (uint64_t)ProfileThreadLog::CAPACITY ? after + 1 - ProfileThreadLog::CAPACITY : 0;
+
+		for (uint64_t i = glm::max(begin, valid); i < end; i++) {
+			const ProfileEvent& event = events[(size_t)(i - begin)];
+			fprintf(pFile, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n", event.name, pLog->threadId, (event.start - s_startTime) * ticksToMicroseconds,
+				(event.end - event.start) * ticksToMicroseconds);
+			first = false;
+		}
+	}
+
+	fprintf(pFile, "\n]}\n");
+	fclose(pFile);
+	return true;
+}
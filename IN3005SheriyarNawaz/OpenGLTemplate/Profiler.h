@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CommonCore.h"
+#include <stdint.h>
+#include <atomic>
+
+// Define as 0 to compile every PROFILE_ZONE and PROFILE_THREAD out
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// One timed zone, in steady clock ticks
+struct ProfileEvent
+{
+	const char* name;		// Only the pointer is kept, so this must be a string literal
+	int64_t start;
+	int64_t end;
+};
+
+// The most recent zones recorded on one thread, in a ring that overwrites the oldest once it is full.  Only the owning
+// thread writes; count is published after each event so another thread can read the ring while it is being written
+struct ProfileThreadLog
+{
+	static const int CAPACITY = 1 << 16;	// Events kept per thread (1.5 MB)
+
+	ProfileEvent events[CAPACITY];
+	std::atomic<uint64_t> count;			// Events ever recorded; the newest is events[(count - 1) % CAPACITY]
+	int threadId;
+	string threadName;
+};
+
+// A scoped-zone CPU profiler.  Zones are timed with std::chrono::steady_clock and recorded into a ring per thread, with
+// no locking once a thread has its ring.  WriteChromeTrace dumps everything still in the rings as Chrome trace_event JSON,
+// which chrome://tracing and ui.perfetto.dev open
+class CProfiler
+{
+public:
+	static int64_t Now();
+	static int64_t NanosecondsToTicks(int64_t nanoseconds);
+	static void Record(const char* name, int64_t start, int64_t end);
+	static void SetThreadName(const char* name);		// Label for the calling thread in the trace
+
+	// A ring shown as its own track in the trace, for events timed somewhere other than the calling thread (such as
+	// GPU passes read back frames later).  Only one thread may record into it
+	static ProfileThreadLog* CreateTrack(const char* name);
+	static void Record(ProfileThreadLog* pLog, const char* name, int64_t start, int64_t end);
+	static bool WriteChromeTrace(const string& filename);
+
+private:
+	static ProfileThreadLog* CreateLog();
+	static ProfileThreadLog* GetThreadLog();
+};
+
+// Times the scope it is declared in
+class CProfileZone
+{
+public:
+	CProfileZone(const char* name) : m_name(name), m_start(CProfiler::Now()) {}
+	~CProfileZone() { CProfiler::Record(m_name, m_start, CProfiler::Now()); }
+
+private:
+	const char* m_name;
+	int64_t m_start;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) CProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) CProfiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#endif
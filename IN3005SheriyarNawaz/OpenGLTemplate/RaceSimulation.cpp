@@ -0,0 +1,332 @@
+#include "RaceSimulation.h"
+#include "CatmullRom.h"
+#include "CollectibleSet.h"
+#include "TrackBroadphase.h"
+#include "Profiler.h"
+
+// Audio and the timer resolution are Windows only.  Elsewhere (the headless driver) the race runs without sound
+#ifdef _WIN32
+#include "Audio.h"
+#include <mmsystem.h>
+
+#pragma comment(lib, "winmm.lib")
+#endif
+
+CRaceSimulation::CRaceSimulation()
+{
+	m_pTrack = NULL;
+	m_pCoins = NULL;
+	m_pTyres = NULL;
+	m_pCoinBroadphase = NULL;
+	m_pTyreBroadphase = NULL;
+	m_pAudio = NULL;
+	m_pCursor = new SplineCursor;
+
+	m_running = false;
+	m_paused = false;
+	m_inputs = 0;
+	m_inputSource = NULL;
+	m_startTime = std::chrono::steady_clock::now();
+
+	m_time = 0.0;
+	m_speed = 0.0f;
+	m_maxSpeed = 100.0f;
+	m_acceleration = 10;
+	m_deceleration = 20;
+	m_breakSpeed = 50;
+	m_turnSpeed = 0.75f;
+	m_furthestSidePosition = 0.8f;
+	m_lap = 0;
+	m_score = 0;
+	m_lives = STARTING_LIVES;
+	m_gameOver = false;
+	m_collisionCooldown = 0.0f;
+
+	m_cameraShaking = false;
+	m_shakeTime = 0.0f;
+	m_shakeDuration = 0.5f;
+	m_shakeIntensity = 0.5f;
+	m_shakeOffset = glm::vec3(0.0f);
+}
+
+CRaceSimulation::~CRaceSimulation()
+{
+	Stop();
+	delete m_pCursor;
+}
+
+void CRaceSimulation::Create(CCatmullRom* pTrack, CCollectibleSet* pCoins, CTrackBroadphase* pCoinBroadphase,
+	CCollectibleSet* pTyres, CTrackBroadphase* pTyreBroadphase, CAudio* pAudio)
+{
+	m_pTrack = pTrack;
+	m_pCoins = pCoins;
+	m_pCoinBroadphase = pCoinBroadphase;
+	m_pTyres = pTyres;
+	m_pTyreBroadphase = pTyreBroadphase;
+	m_pAudio = pAudio;
+
+	// Publish the starting state so the renderer has something to draw before the first step
+	PublishSnapshot();
+}
+
+void CRaceSimulation::Start()
+{
+	if (m_running)
+		return;
+
+	m_running = true;
+	m_thread = std::thread(&CRaceSimulation::Run, this);
+}
+
+void CRaceSimulation::Stop()
+{
+	m_running = false;
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void CRaceSimulation::SetPaused(bool paused)
+{
+	m_paused = paused;
+}
+
+void CRaceSimulation::SetInputs(unsigned int inputs)
+{
+	m_inputs.store(inputs, std::memory_order_relaxed);
+}
+
+// Set before Start
+void CRaceSimulation::SetInputSource(RaceInputSource source)
+{
+	m_inputSource = source;
+}
+
+double CRaceSimulation::GetStepLength()
+{
+	return 1000.0 / STEP_RATE;
+}
+
+double CRaceSimulation::GetTime() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+
+// Only the last state before each publish is seen, so the snapshot is filled here rather than after every step
+void CRaceSimulation::PublishSnapshot()
+{
+	FillSnapshot(m_snapshots.GetWriteBuffer());
+	m_snapshots.Publish();
+}
+
+// Back to the start line with full lives and no score.  The simulation clock carries on
+void CRaceSimulation::Reset()
+{
+	m_previous = CarState();
+	m_current = CarState();
+	m_speed = 0.0f;
+	m_lap = 0;
+	m_score = 0;
+	m_lives = STARTING_LIVES;
+	m_gameOver = false;
+	m_collisionCooldown = 0.0f;
+
+	m_cameraShaking = false;
+	m_shakeTime = 0.0f;
+	m_shakeOffset = glm::vec3(0.0f);
+
+	m_pCoins->RespawnAll();
+}
+
+bool CRaceSimulation::IsGameOver() const
+{
+	return m_gameOver;
+}
+
+bool CRaceSimulation::AcquireSnapshot()
+{
+	return m_snapshots.Acquire();
+}
+
+const RaceSnapshot& CRaceSimulation::GetSnapshot() const
+{
+	return m_snapshots.GetReadBuffer();
+}
+
+glm::vec3 CRaceSimulation::ComputeCarPosition(const SplineFrame& frame, float sidePosition)
+{
+	float trackWidth = 50.0f;
+	glm::vec3 position = frame.p + frame.N * (trackWidth * 0.5f * sidePosition);
+	position.y = frame.p.y + 0.5f;
+	return position;
+}
+
+// The simulation thread.  Steps are run whenever the clock has moved on by a whole step, then the thread sleeps until
+// the next one is due.  After a long stall (e.g. a breakpoint) the missed time is dropped rather than caught up
+void CRaceSimulation::Run()
+{
+	PROFILE_THREAD("Simulation");
+#ifdef _WIN32
+	timeBeginPeriod(1); // Sleep to the nearest ms rather than the default 15.6 ms
+#endif
+
+	const double step = GetStepLength();
+	m_time = GetTime();
+
+	while (m_running) {
+		double now = GetTime();
+		if (m_paused) {
+			m_time = now;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			continue;
+		}
+
+		if (now - m_time > MAX_CATCH_UP)
+			m_time = now - MAX_CATCH_UP;
+
+		// Input is sampled here rather than handed over by the render thread, so it keeps up when rendering stalls
+		if (m_inputSource != NULL && m_time + step <= now)
+			SetInputs(m_inputSource());
+
+		bool stepped = false;
+		while (m_time + step <= now) {
+			Step(step);
+			stepped = true;
+		}
+
+		if (stepped) {
+			PublishSnapshot();
+#ifdef _WIN32
+			if (m_pAudio != NULL)
+				m_pAudio->Update();
+#endif
+		}
+
+		double wait = m_time + step - GetTime();
+		if (wait > 0.0)
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(wait));
+	}
+
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+void CRaceSimulation::Step(double dt)
+{
+	PROFILE_ZONE("CRaceSimulation::Step");
+	unsigned int inputs = m_inputs.load(std::memory_order_relaxed);
+	m_previous = m_current;
+	m_time += dt;
+
+	//Player inputs change the speed of the car
+	if ((inputs & INPUT_ACCELERATE) && !(inputs & INPUT_BRAKE)) {
+		m_speed += m_acceleration * (dt / 1000.0f); //Accelerate
+		if (m_speed > m_maxSpeed)
+			m_speed = m_maxSpeed;
+	}
+	else if ((inputs & INPUT_DECELERATE) && !(inputs & INPUT_BRAKE)) {
+		m_speed -= m_deceleration * (dt / 1000.0f); //Slow down at a different rate when decelerating
+		if (m_speed < 0.0f)
+			m_speed = 0.0f;
+	}
+	else if (inputs & INPUT_BRAKE) {
+		m_speed -= m_breakSpeed * (dt / 1000.0f); //Slow down when breaking
+		if (m_speed < 0.0f)
+			m_speed = 0.0f;
+	}
+
+	m_current.distance += m_speed * (dt / 1000.0f); //Update cars distance along the spline using speed of the car
+
+	//Turn left or right using turn speed
+	if (inputs & INPUT_TURN_LEFT)
+		m_current.sidePosition -= m_turnSpeed * (dt / 1000.0f);
+	else if (inputs & INPUT_TURN_RIGHT)
+		m_current.sidePosition += m_turnSpeed * (dt / 1000.0f);
+
+	//Confine the cars side to side position within the track
+	m_current.sidePosition = glm::clamp(m_current.sidePosition, -m_furthestSidePosition, m_furthestSidePosition);
+
+	m_lap = m_pTrack->CurrentLap(m_current.distance);
+
+	SplineFrame frame;
+	m_pTrack->SampleFrame(m_current.distance, *m_pCursor, frame);
+
+	if (!m_gameOver)
+		CheckCollision(ComputeCarPosition(frame, m_current.sidePosition));
+
+	if (m_lives <= 0)
+		m_gameOver = true;
+
+	if (m_collisionCooldown > 0.0f) //Reduce collision cooldown to 0 to allow for collisions with a tyre after another time. i.e. invulnerability period when hitting tyre
+		m_collisionCooldown -= (float)(dt / 1000.0f);
+
+	UpdateCameraShake(dt);
+}
+
+void CRaceSimulation::CheckCollision(const glm::vec3& carPosition)
+{
+	PROFILE_ZONE("CRaceSimulation::CheckCollision");
+	float collisionDistance = 15.0f;
+
+	// Only objects near the car along the track are tested.  The search range is doubled because on the inside of a bend,
+	// points off the centreline are closer together than their distances along it
+	m_collisionCandidates.clear();
+	m_pCoinBroadphase->Query(m_current.distance, 2.0f * collisionDistance, m_collisionCandidates);
+
+	//If the distance between car and a coin is within a range, use that as a collision. Mark the coin as collected and increase score 
+	m_collisionHits.clear();
+	m_pCoins->FindWithin(carPosition, collisionDistance, m_collisionCandidates, m_collisionHits);
+	for (size_t h = 0; h < m_collisionHits.size(); h++) {
+		m_pCoins->Collect(m_collisionHits[h]);
+		m_score += 100;
+	}
+
+	float tyreCollisionDistance = 15.0f;
+	m_collisionCandidates.clear();
+	m_pTyreBroadphase->Query(m_current.distance, 2.0f * tyreCollisionDistance, m_collisionCandidates);
+
+	//If the distance between car and a tyre is within a range, use that as a collision. Begin a timer to prevent lives instantly going down to 0 
+	m_collisionHits.clear();
+	m_pTyres->FindWithin(carPosition, tyreCollisionDistance, m_collisionCandidates, m_collisionHits);
+	if (!m_collisionHits.empty() && m_collisionCooldown <= 0.0f) {
+		m_lives -= 1;
+		m_collisionCooldown = 1.0f;
+		m_cameraShaking = true;
+		m_shakeTime = 0.0f;
+	}
+}
+
+// After hitting a tyre the camera is thrown about by a random offset that dies away over m_shakeDuration
+void CRaceSimulation::UpdateCameraShake(double dt)
+{
+	m_shakeOffset = glm::vec3(0.0f);
+	if (!m_cameraShaking)
+		return;
+
+	m_shakeTime += (float)(dt / 1000.0f);
+	if (m_shakeTime >= m_shakeDuration) {
+		m_cameraShaking = false;
+		return;
+	}
+
+	//Apply a shake factor with a random offset on every angle
+	float shakeFactor = m_shakeIntensity * (1.0f - (m_shakeTime / m_shakeDuration));
+	m_shakeOffset.x = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * shakeFactor;
+	m_shakeOffset.y = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * shakeFactor;
+	m_shakeOffset.z = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * shakeFactor;
+}
+
+// Copies the race state into a snapshot.  The snapshot slots are reused, so after the first few this does not allocate
+void CRaceSimulation::FillSnapshot(RaceSnapshot& snapshot)
+{
+	snapshot.previous = m_previous;
+	snapshot.current = m_current;
+	snapshot.time = m_time;
+	snapshot.speed = m_speed;
+	snapshot.score = m_score;
+	snapshot.lives = m_lives;
+	snapshot.lap = m_lap;
+	snapshot.gameOver = m_gameOver;
+	snapshot.shakeOffset = m_shakeOffset;
+	snapshot.coinsCollected = m_pCoins->GetCollectedMask();
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "CommonCore.h"
+#include "TripleBuffer.h"
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+class CCatmullRom;
+class CCollectibleSet;
+class CTrackBroadphase;
+class CAudio;
+struct SplineCursor;
+struct SplineFrame;
+
+// Player controls, combined into one bitmask so they can be handed to the simulation thread in a single store
+enum RaceInput
+{
+	INPUT_ACCELERATE = 1,
+	INPUT_DECELERATE = 2,
+	INPUT_BRAKE = 4,
+	INPUT_TURN_LEFT = 8,
+	INPUT_TURN_RIGHT = 16
+};
+
+// Reads the current RaceInput flags.  Called on the simulation thread
+typedef unsigned int (*RaceInputSource)();
+
+// Where the car is along the track
+struct CarState
+{
+	CarState() : distance(0.0f), sidePosition(0.0f) {}
+	float distance;			// Distance along the centreline
+	float sidePosition;		// -1 to 1 across the track
+};
+
+// Everything the renderer needs from one simulation step.  The state before the step is included so the renderer
+// can interpolate between the two
+struct RaceSnapshot
+{
+	RaceSnapshot() : time(0.0), speed(0.0f), score(0), lives(0), lap(0), gameOver(false), shakeOffset(0.0f) {}
+	CarState previous;
+	CarState current;
+	double time;						// Simulation clock (ms) at which current is valid
+	float speed;
+	int score;
+	int lives;
+	int lap;
+	bool gameOver;
+	glm::vec3 shakeOffset;				// Camera shake to add this step, zero when not shaking
+	vector<uint64_t> coinsCollected;	// Collected mask of the coin set
+};
+
+// The race itself: car kinematics, collisions with coins and tyres, and camera shake.  Runs at a fixed rate on its own
+// thread and publishes a RaceSnapshot after every batch of steps, so rendering and simulation never wait on each other.
+// The track, collectible sets and broadphases are borrowed, and must not be changed by anything else while it runs.
+class CRaceSimulation
+{
+public:
+	static const int STEP_RATE = 240;			// Fixed steps per second
+	static const int MAX_CATCH_UP = 250;		// Longest stall (ms) the simulation will catch up on
+	static const int STARTING_LIVES = 5;
+
+	CRaceSimulation();
+	~CRaceSimulation();
+
+	void Create(CCatmullRom* pTrack, CCollectibleSet* pCoins, CTrackBroadphase* pCoinBroadphase,
+		CCollectibleSet* pTyres, CTrackBroadphase* pTyreBroadphase, CAudio* pAudio);
+	void Start();								// Starts the simulation thread
+	void Stop();								// Stops and joins it
+	void SetPaused(bool paused);				// While paused no time passes for the race
+
+	void SetInputs(unsigned int inputs);		// RaceInput flags, from any thread
+	void SetInputSource(RaceInputSource source);	// Polled by the simulation thread before each batch of steps, in place of SetInputs
+	void Step(double dt);						// Advances the race by dt ms.  May be called directly, without Start
+	void PublishSnapshot();						// Hands the state after the last step to the render side
+	void Reset();								// Starts the race again with every coin back.  Only from the thread that steps
+	bool IsGameOver() const;					// Only from the thread that steps
+
+	// Render thread side
+	bool AcquireSnapshot();						// Picks up the latest snapshot, if there is a new one
+	const RaceSnapshot& GetSnapshot() const;
+	double GetTime() const;						// Simulation clock, ms
+
+	static double GetStepLength();				// ms
+	static glm::vec3 ComputeCarPosition(const SplineFrame& frame, float sidePosition);	// Car position from its frame on the centreline
+
+private:
+	void Run();
+	void CheckCollision(const glm::vec3& carPosition);
+	void UpdateCameraShake(double dt);
+	void FillSnapshot(RaceSnapshot& snapshot);
+
+	CCatmullRom* m_pTrack;
+	CCollectibleSet* m_pCoins;
+	CCollectibleSet* m_pTyres;
+	CTrackBroadphase* m_pCoinBroadphase;
+	CTrackBroadphase* m_pTyreBroadphase;
+	CAudio* m_pAudio;
+	SplineCursor* m_pCursor;
+
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+	std::atomic<bool> m_paused;
+	std::atomic<unsigned int> m_inputs;
+	RaceInputSource m_inputSource;
+	std::chrono::steady_clock::time_point m_startTime;
+	CTripleBuffer<RaceSnapshot> m_snapshots;
+
+	// Race state, only touched by the simulation thread once it has started
+	double m_time;
+	CarState m_previous;
+	CarState m_current;
+	float m_speed;
+	float m_maxSpeed;
+	float m_acceleration;
+	float m_deceleration;
+	float m_breakSpeed;
+	float m_turnSpeed;
+	float m_furthestSidePosition;
+	int m_lap;
+	int m_score;
+	int m_lives;
+	bool m_gameOver;
+	float m_collisionCooldown;
+
+	bool m_cameraShaking;
+	float m_shakeTime;
+	float m_shakeDuration;
+	float m_shakeIntensity;
+	glm::vec3 m_shakeOffset;
+
+	vector<int> m_collisionCandidates;
+	vector<int> m_collisionHits;
+};
@@ -0,0 +1,519 @@
+/*
+ Offscreen render benchmark.  Draws the race scene (terrain, coins, tyres and the track, with the clustered track
+ lights) from a chase camera driven once round the track, in a COffscreenContext with no window.  Reports the CPU
+ time spent submitting each frame, the draw calls it took, and the frame time including the GPU (glFinish), as
+ percentiles over the run, then the GPU time of each pass.  A trace of the run is written to render_benchmark.json.
+ Every LIGHT_CHECK_INTERVAL frames the depth buffer is read back and a grid of fragments is lit by brute force: each
+ track light in range of a fragment must be in that fragment's cluster, and the run fails if one is missing.
+ The car, light posts, skybox and HUD are left out, since they need assimp, the cube map and FreeType.
+
+ Not part of the Windows build (it has its own main).  On Linux, from this directory:
+
+   g++ -O2 -std=c++17 -pthread -I. RenderBenchmark.cpp OffscreenContext.cpp CatmullRom.cpp TrackMesh.cpp
+       TrackPlacements.cpp CollectibleSet.cpp TrackBroadphase.cpp RaceSimulation.cpp Frustum.cpp Shaders.cpp Texture.cpp
+       Plane.cpp Coin.cpp Tyre.cpp InstanceBuffer.cpp UniformBuffer.cpp LightClusters.cpp VertexBufferObject.cpp
+       VertexBufferObjectIndexed.cpp Profiler.cpp GpuTimer.cpp GLStateCache.cpp RenderQueue.cpp SceneDrawList.cpp
+       GeometryArena.cpp -lEGL -lGL -lfreeimage -o render_benchmark
+
+ Set LIBGL_ALWAYS_SOFTWARE=1 to measure on llvmpipe even where there is a GPU.
+
+ Usage: render_benchmark [frames] [width height]
+*/
+
+#include "Common.h"
+#include "OffscreenContext.h"
+#include "CatmullRom.h"
+#include "TrackMesh.h"
+#include "TrackPlacements.h"
+#include "RaceSimulation.h"
+#include "Frustum.h"
+#include "Shaders.h"
+#include "Plane.h"
+#include "Coin.h"
+#include "Tyre.h"
+#include "InstanceBuffer.h"
+#include "UniformBuffer.h"
+#include "LightClusters.h"
+#include "GpuTimer.h"
+#include "GLStateCache.h"
+#include "RenderQueue.h"
+#include "SceneDrawList.h"
+#include "GeometryArena.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+
+static const int WARM_UP_FRAMES = 20;	// Not measured: the first frames compile shader variants and fault in textures
+static const int LAP_FRAMES = 1200;		// Frames the camera takes to go once round the track
+static const int LIGHT_CHECK_INTERVAL = 60;	// Frames between checks of the light clusters, outside the timings
+static const int LIGHT_CHECK_STEP = 8;		// Pixels between the fragments checked, across and up
+static const float LIGHT_RANGE = 80.0f;		// Lights have no effect beyond this (maxRange in mainShader.frag)
+
+// Materials and meshes as they are numbered in render queue keys
+enum BenchmarkMaterial { MATERIAL_GROUND, MATERIAL_COIN, MATERIAL_TYRE, MATERIAL_TRACK };
+enum BenchmarkMesh { MESH_TERRAIN, MESH_COIN, MESH_TYRE, MESH_TRACK };
+
+static void DrawPlane(void* pObject, void*) { ((CPlane*)pObject)->Render(); }
+static void DrawCoins(void* pObject, void* pArgument) { ((CCoin*)pObject)->RenderInstanced((CInstanceBuffer*)pArgument); }
+static void DrawTyres(void* pObject, void* pArgument) { ((CTyre*)pObject)->RenderInstanced((CInstanceBuffer*)pArgument); }
+static void DrawTrack(void* pObject, void*) { ((CTrackMesh*)pObject)->RenderSelectedChunks(); }
+
+// Everything drawn each frame.  Mirrors what Game::Initialise creates for the same objects
+struct BenchmarkScene
+{
+	CShaderProgram program;
+	CUniformBuffer cameraBlock;
+	CUniformBuffer lightBlock;
+	LightBlock lightData;
+	CLightClusters lightClusters;
+	CFrustum frustum;
+	CGpuTimer gpuTimer;
+	vector<CShaderProgram*> programs;
+	CRenderQueue renderQueue;
+
+	CCatmullRom track;
+	CTrackMesh trackMesh;
+	double trackBuildTime;					// ms to build and upload the track mesh
+	CPlane terrain;
+	CCoin coin;
+	CTyre tyre;
+	CInstanceBuffer coinInstances;
+	CInstanceBuffer tyreInstances;
+	CBoundingSphereTree coinTree;
+	CBoundingSphereTree tyreTree;
+	vector<TrackPlacement> lights;
+	vector<ClusteredLight> trackLights;		// Sized once, overwritten each frame
+	vector<int> visibleInstances;			// Scratch for CullInstances
+};
+
+// What one frame cost
+struct FrameSample
+{
+	double submitTime;		// ms on the CPU from the start of the frame to the last GL call
+	double frameTime;		// ms until the GPU had finished the frame
+	int drawCalls;
+	int trackTriangles;
+	int stateCallsIssued;	// Through CGLStateCache
+	int stateCallsSkipped;
+	CullStats cullStats;
+};
+
+// The track lights that reach the fragments checked, against the lights their clusters hand them
+struct LightCheck
+{
+	int frames;
+	int fragments;
+	double lightsInRange;	// Summed over the fragments
+	double lightsEvaluated;
+	int maxLightsInRange;
+	int missed;				// In range of a fragment but not in its cluster
+};
+
+static glm::mat3 ComputeNormalMatrix(const glm::mat4& modelViewMatrix)
+{
+	return glm::transpose(glm::inverse(glm::mat3(modelViewMatrix)));
+}
+
+static bool CreateScene(BenchmarkScene& scene, int width, int height)
+{
+	CShader vertexShader, fragmentShader;
+	if (!vertexShader.LoadShader("resources/shaders/mainShader.vert", GL_VERTEX_SHADER) ||
+		!fragmentShader.LoadShader("resources/shaders/mainShader.frag", GL_FRAGMENT_SHADER))
+		return false;
+
+	scene.program.CreateProgram();
+	scene.program.AddShaderToProgram(&vertexShader);
+	scene.program.AddShaderToProgram(&fragmentShader);
+	if (!scene.program.LinkProgram())
+		return false;
+
+	scene.cameraBlock.Create(sizeof(CameraBlock), CAMERA_BLOCK_BINDING);
+	scene.lightBlock.Create(sizeof(LightBlock), LIGHT_BLOCK_BINDING);
+	scene.program.BindUniformBlock("CameraBlock", CAMERA_BLOCK_BINDING);
+	scene.program.BindUniformBlock("LightBlock", LIGHT_BLOCK_BINDING);
+	scene.lightClusters.Create(width, height, 64, 24, 0.5f, 5000.0f);
+	scene.gpuTimer.Create();
+
+	// Same materials as Game::Initialise, except that the track keeps the values it was first given there
+	scene.programs.push_back(&scene.program);
+	scene.renderQueue.Create(&scene.programs, &scene.gpuTimer);
+	scene.renderQueue.SetMaterial(MATERIAL_GROUND, RenderMaterial(glm::vec3(0.35f), glm::vec3(0.4f), glm::vec3(1.0f), 30.0f));
+	scene.renderQueue.SetMaterial(MATERIAL_TYRE, RenderMaterial(glm::vec3(0.2f), glm::vec3(0.6f), glm::vec3(0.4f), 10.0f));
+	scene.renderQueue.SetMaterial(MATERIAL_TRACK, RenderMaterial(glm::vec3(0.8f), glm::vec3(0.9f), glm::vec3(1.0f), 25.0f));
+
+	RenderMaterial gold(glm::vec3(0.7f, 0.6f, 0.2f), glm::vec3(1.0f, 0.8f, 0.2f), glm::vec3(1.0f, 0.9f, 0.6f), 120.0f);
+	gold.spinSpeed = 250.0f;
+	gold.wobbleAmount = 10.0f;
+	gold.wobbleSpeed = 3.0f;
+	scene.renderQueue.SetMaterial(MATERIAL_COIN, gold);
+
+	scene.terrain.Create("resources/textures/", "grassfloor01.jpg", 2000.0f, 2000.0f, 50.0f);
+	scene.coin.Create("resources/textures/", "gold.png", 20, 0.5f);
+	scene.tyre.Create("resources/textures/", "tyre.png", 32, 24, 1.0f, 0.3f);
+
+	CGLStateCache::Enable(GL_CULL_FACE);
+
+	scene.track.CreateCentreline();
+	scene.track.CreateOffsetCurves();
+	std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+	scene.trackMesh.Create(&scene.track, "resources/textures/", "road.jpg");
+	scene.trackBuildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+	// Same transforms and bounding spheres as Game::BakeTrackPlacements
+	CTrackPlacements placements;
+	placements.Create(&scene.track);
+
+	vector<glm::mat4> transforms;
+	vector<BoundingSphere> spheres;
+	const vector<TrackPlacement>& coins = placements.GetCoins();
+	for (size_t i = 0; i < coins.size(); i++) {
+		transforms.push_back(glm::translate(glm::mat4(1.0f), coins[i].position));
+		spheres.push_back(BoundingSphere(coins[i].position, 1.1f));
+	}
+	scene.coinInstances.Create(transforms);
+	scene.coinTree.Build(spheres);
+
+	transforms.clear();
+	spheres.clear();
+	const vector<TrackPlacement>& tyres = placements.GetTyres();
+	for (size_t i = 0; i < tyres.size(); i++) {
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), tyres[i].position);
+		transform = glm::rotate(transform, atan2(-tyres[i].direction.x, -tyres[i].direction.z), glm::vec3(0.0f, 1.0f, 0.0f));
+		transform = glm::rotate(transform, glm::radians(5.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		transforms.push_back(glm::scale(transform, glm::vec3(6.0f)));
+		spheres.push_back(BoundingSphere(tyres[i].position, (1.0f + 0.3f) * 6.0f));
+	}
+	scene.tyreInstances.Create(transforms);
+	scene.tyreTree.Build(spheres);
+
+	scene.lights = placements.GetLights();
+	scene.trackLights.resize(scene.lights.size());
+	return true;
+}
+
+// Chase camera from Game::HandleCameraAngles, following a car that drives down the middle of the track
+static void PlaceCamera(BenchmarkScene& scene, int frame, glm::vec3& eye, glm::vec3& target)
+{
+	static SplineCursor cursor;
+	SplineFrame splineFrame;
+	float distance = scene.track.GetTrackLength() * (frame % LAP_FRAMES) / LAP_FRAMES;
+	scene.track.SampleFrame(distance, cursor, splineFrame);
+
+	target = CRaceSimulation::ComputeCarPosition(splineFrame, 0.0f);
+	eye = target - 25.0f * splineFrame.T + glm::vec3(0.0f, 8.0f, 0.0f);
+}
+
+// The light block and clusters, as Game::UpdateLightBlock builds them with the lights steady
+static void UpdateLights(BenchmarkScene& scene, const glm::mat4& viewMatrix, const glm::mat4& projMatrix)
+{
+	glm::mat3 viewNormalMatrix = ComputeNormalMatrix(viewMatrix);
+	LightBlock& lights = scene.lightData;
+
+	lights.light1.position = viewMatrix * glm::vec4(-100, 100, -100, 1);
+	lights.light1.La = glm::vec3(0.06f, 0.06f, 0.08f);
+	lights.light1.Ld = glm::vec3(0.0f);
+	lights.light1.Ls = glm::vec3(0.0f);
+	lights.light1.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	lights.light1.exponent = 1.0f;
+	lights.light1.cutoff = 180.0f;
+
+	int numLights = (int)scene.lights.size();
+	glm::vec3 ambientSum = glm::vec3(0.0f);
+	for (int i = 0; i < numLights; i++) {
+		ClusteredLight& light = scene.trackLights[i];
+		light.position = glm::vec4(glm::vec3(viewMatrix * glm::vec4(scene.lights[i].position, 1.0f)), 0.5f);
+		light.direction = glm::vec4(glm::normalize(viewNormalMatrix * scene.lights[i].direction), 75.0f);
+		light.La = glm::vec4(glm::vec3(0.1f), 0.0f);
+		light.Ld = glm::vec4(scene.lights[i].colour, 0.0f);
+		light.Ls = glm::vec4(scene.lights[i].colour * 1.5f, 0.0f);
+		if (i < 16)
+			ambientSum += glm::vec3(light.La);
+	}
+	lights.trackAmbient = glm::vec4(ambientSum, 0.0f);
+
+	scene.lightClusters.Update(scene.trackLights, LIGHT_RANGE, projMatrix);
+	lights.clusterDims = scene.lightClusters.GetDimensions();
+	lights.clusterDepth = scene.lightClusters.GetDepthParameters();
+	scene.lightBlock.Update(&lights, sizeof(LightBlock));
+}
+
+// As Game::CullInstances, with nothing collected
+static void CullInstances(BenchmarkScene& scene, CBoundingSphereTree& tree, CInstanceBuffer& instances, CullStats& stats)
+{
+	vector<int>& visible = scene.visibleInstances;
+	visible.clear();
+	tree.Query(scene.frustum, visible, &stats);
+
+	size_t next = 0;
+	for (int i = 0; i < tree.GetNumLeaves(); i++) {
+		bool inFrustum = next < visible.size() && visible[next] == i;
+		if (inFrustum)
+			next++;
+		instances.SetVisible(i, inFrustum);
+	}
+}
+
+static void RenderFrame(BenchmarkScene& scene, int frame, const glm::mat4& projMatrix, FrameSample& sample)
+{
+	PROFILE_ZONE("RenderFrame");
+	CShaderProgram* pProgram = &scene.program;
+	sample.cullStats = CullStats();
+	CGLStateCache::ResetCounters();
+
+	scene.gpuTimer.BeginFrame();
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	CGLStateCache::Enable(GL_DEPTH_TEST);
+
+	pProgram->UseProgram();
+	pProgram->SetUniform("sampler0", 0);
+	pProgram->SetUniform("CubeMapTex", 1);
+	pProgram->SetUniform("lightData", LIGHT_DATA_TEXTURE_UNIT);
+	pProgram->SetUniform("clusterGrid", CLUSTER_GRID_TEXTURE_UNIT);
+	pProgram->SetUniform("lightIndices", LIGHT_INDEX_TEXTURE_UNIT);
+
+	glm::vec3 eye, target;
+	PlaceCamera(scene, frame, eye, target);
+	glm::mat4 viewMatrix = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	CameraBlock cameraBlock;
+	cameraBlock.projMatrix = projMatrix;
+	cameraBlock.viewMatrix = viewMatrix;
+	scene.cameraBlock.Update(&cameraBlock, sizeof(cameraBlock));
+	scene.frustum.Update(projMatrix, viewMatrix);
+
+	UpdateLights(scene, viewMatrix, projMatrix);
+	scene.lightClusters.Bind();
+
+	pProgram->SetUniform("animation.time", frame / 60.0f);
+
+	// Terrain, tested as a flat box as in Game::Render
+	BoundingBox terrainBounds(glm::vec3(-1000.0f, 0.0f, -1000.0f), glm::vec3(1000.0f, 0.0f, 1000.0f));
+	if (scene.frustum.IsBoxVisible(terrainBounds)) {
+		RenderPacket terrain;
+		terrain.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_GROUND, MESH_TERRAIN,
+			CRenderQueue::GetViewDepth(eye, glm::vec3(0.0f), glm::length(terrainBounds.max)));
+		terrain.draw = DrawPlane;
+		terrain.pObject = &scene.terrain;
+		terrain.modelViewMatrix = viewMatrix;
+		terrain.gpuPass = GPU_PASS_TERRAIN;
+		scene.renderQueue.Submit(terrain);
+		sample.cullStats.visible++;
+	}
+	else
+		sample.cullStats.culled++;
+
+	// Coins, spinning as in Game::RenderCoinsAlongTrack
+	CullInstances(scene, scene.coinTree, scene.coinInstances, sample.cullStats);
+	if (scene.coinInstances.GetNumInstances() > 0) {
+		RenderPacket coins;
+		coins.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_COIN, MESH_COIN, 0.0f);
+		coins.draw = DrawCoins;
+		coins.pObject = &scene.coin;
+		coins.pArgument = &scene.coinInstances;
+		coins.instanced = true;
+		coins.gpuPass = GPU_PASS_COINS;
+		scene.renderQueue.Submit(coins);
+	}
+
+	// Tyres
+	CullInstances(scene, scene.tyreTree, scene.tyreInstances, sample.cullStats);
+	if (scene.tyreInstances.GetNumInstances() > 0) {
+		RenderPacket tyres;
+		tyres.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_TYRE, MESH_TYRE, 0.0f);
+		tyres.draw = DrawTyres;
+		tyres.pObject = &scene.tyre;
+		tyres.pArgument = &scene.tyreInstances;
+		tyres.instanced = true;
+		tyres.gpuPass = GPU_PASS_TYRES;
+		scene.renderQueue.Submit(tyres);
+	}
+
+	// Track, one multi-draw for every visible chunk
+	scene.trackMesh.SelectTrackChunks(eye, &scene.frustum, &sample.cullStats);
+	sample.trackTriangles = scene.trackMesh.GetTrackTriangles();
+	if (sample.trackTriangles > 0) {
+		RenderPacket track;
+		track.key = CRenderQueue::MakeKey(RENDER_PASS_OPAQUE, 0, MATERIAL_TRACK, MESH_TRACK, 0.0f);
+		track.draw = DrawTrack;
+		track.pObject = &scene.trackMesh;
+		track.modelViewMatrix = viewMatrix;
+		track.gpuPass = GPU_PASS_TRACK;
+		scene.renderQueue.Submit(track);
+	}
+
+	scene.renderQueue.Execute();
+	sample.drawCalls = scene.renderQueue.GetStats().packets;
+
+	scene.gpuTimer.EndFrame();
+
+	sample.stateCallsIssued = CGLStateCache::GetCounters().GetTotalIssued();
+	sample.stateCallsSkipped = CGLStateCache::GetCounters().GetTotalSkipped();
+}
+
+// Reads back the depth of the frame just drawn and, for every LIGHT_CHECK_STEP'th pixel that was drawn to, finds the
+// eye-space position and brute-forces the track lights in range of it
+static void CheckLightClusters(BenchmarkScene& scene, const glm::mat4& projMatrix, int width, int height, LightCheck& check)
+{
+	vector<float> depths(width * height);
+	glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, &depths[0]);
+
+	glm::mat4 inverseProjMatrix = glm::inverse(projMatrix);
+	int numLights = (int)scene.trackLights.size();
+	for (int y = LIGHT_CHECK_STEP / 2; y < height; y += LIGHT_CHECK_STEP) {
+		for (int x = LIGHT_CHECK_STEP / 2; x < width; x += LIGHT_CHECK_STEP) {
+			float depth = depths[y * width + x];
+			if (depth >= 1.0f)
+				continue;	// Cleared, nothing drawn here
+
+			glm::vec2 fragCoord(x + 0.5f, y + 0.5f);
+			glm::vec4 ndc(fragCoord.x / width * 2.0f - 1.0f, fragCoord.y / height * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+			glm::vec4 eye = inverseProjMatrix * ndc;
+			glm::vec3 position = glm::vec3(eye) / eye.w;
+			int cluster = scene.lightClusters.FindCluster(fragCoord, -position.z);
+
+			int inRange = 0;
+			for (int i = 0; i < numLights; i++) {
+				if (glm::distance(position, glm::vec3(scene.trackLights[i].position)) >= LIGHT_RANGE)
+					continue;
+				inRange++;
+				if (!scene.lightClusters.IsLightInCluster(cluster, i))
+					check.missed++;
+			}
+
+			check.fragments++;
+			check.lightsInRange += inRange;
+			check.lightsEvaluated += scene.lightClusters.GetNumLightsInCluster(cluster);
+			check.maxLightsInRange = glm::max(check.maxLightsInRange, inRange);
+		}
+	}
+	check.frames++;
+}
+
+static double Percentile(const vector<double>& sorted, double p)
+{
+	size_t index = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[glm::min(index, sorted.size() - 1)];
+}
+
+static void PrintTimes(const char* name, vector<double> times)
+{
+	std::sort(times.begin(), times.end());
+	double total = 0.0;
+	for (size_t i = 0; i < times.size(); i++)
+		total += times[i];
+
+	printf("%-12s %8.3f %8.3f %8.3f %8.3f %8.3f\n", name, total / times.size(), Percentile(times, 50.0), Percentile(times, 90.0),
+		Percentile(times, 99.0), times.back());
+}
+
+int main(int argc, char** argv)
+{
+	PROFILE_THREAD("Main");
+	int numFrames = LAP_FRAMES;
+	int width = 800, height = 600;	// GameWindow::SCREEN_WIDTH x SCREEN_HEIGHT
+	if (argc > 1)
+		numFrames = glm::max(1, atoi(argv[1]));
+	if (argc > 3) {
+		width = atoi(argv[2]);
+		height = atoi(argv[3]);
+	}
+
+	COffscreenContext context;
+	if (!context.Create(width, height))
+		return 1;
+
+	BenchmarkScene* pScene = new BenchmarkScene;
+	if (!CreateScene(*pScene, width, height))
+		return 1;
+
+	glm::mat4 projMatrix = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.5f, 5000.0f);
+	glClearColor(0.02f, 0.02f, 0.04f, 0.5f);
+	glClearDepth(1.0f);
+
+	vector<FrameSample> samples;
+	samples.reserve(numFrames);
+	LightCheck lightCheck = LightCheck();
+	int firstUploads = 0, firstCoinUploads = 0, firstTyreUploads = 0;
+	for (int frame = -WARM_UP_FRAMES; frame < numFrames; frame++) {
+		if (frame == 0) {
+			firstUploads = pScene->trackMesh.GetDrawUploads();
+			firstCoinUploads = pScene->coinInstances.GetUploads();
+			firstTyreUploads = pScene->tyreInstances.GetUploads();
+		}
+
+		FrameSample sample;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		RenderFrame(*pScene, glm::max(frame, 0), projMatrix, sample);
+		std::chrono::steady_clock::time_point submitted = std::chrono::steady_clock::now();
+		glFinish();
+		std::chrono::steady_clock::time_point finished = std::chrono::steady_clock::now();
+
+		sample.submitTime = std::chrono::duration<double, std::milli>(submitted - start).count();
+		sample.frameTime = std::chrono::duration<double, std::milli>(finished - start).count();
+		if (frame >= 0)
+			samples.push_back(sample);
+		if (frame >= 0 && frame % LIGHT_CHECK_INTERVAL == 0)
+			CheckLightClusters(*pScene, projMatrix, width, height, lightCheck);
+	}
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR)
+		fprintf(stderr, "GL error 0x%x during the run\n", error);
+
+	vector<double> submitTimes, frameTimes;
+	double drawCalls = 0.0, triangles = 0.0, visible = 0.0, culled = 0.0, stateIssued = 0.0, stateSkipped = 0.0;
+	int maxDrawCalls = 0;
+	for (size_t i = 0; i < samples.size(); i++) {
+		submitTimes.push_back(samples[i].submitTime);
+		frameTimes.push_back(samples[i].frameTime);
+		drawCalls += samples[i].drawCalls;
+		maxDrawCalls = glm::max(maxDrawCalls, samples[i].drawCalls);
+		triangles += samples[i].trackTriangles;
+		visible += samples[i].cullStats.visible;
+		culled += samples[i].cullStats.culled;
+		stateIssued += samples[i].stateCallsIssued;
+		stateSkipped += samples[i].stateCallsSkipped;
+	}
+	double n = (double)samples.size();
+
+	printf("Renderer: %s\n", context.GetRenderer());
+	printf("%d frames at %dx%d, after %d warm-up frames\n\n", numFrames, width, height, WARM_UP_FRAMES);
+	printf("%-12s %8s %8s %8s %8s %8s\n", "ms", "mean", "p50", "p90", "p99", "max");
+	PrintTimes("CPU submit", submitTimes);
+	PrintTimes("Frame", frameTimes);
+	printf("\nDraw calls per frame: %.2f mean, %d max\n", drawCalls / n, maxDrawCalls);
+	printf("Objects per frame: %.1f visible, %.1f culled\n", visible / n, culled / n);
+	printf("Track triangles per frame: %.0f\n", triangles / n);
+	printf("Track mesh built in %.2f ms (%d chunks)\n", pScene->trackBuildTime, pScene->trackMesh.GetNumTrackChunks());
+	printf("Track draw commands uploaded on %d of %d frames (%s)\n", pScene->trackMesh.GetDrawUploads() - firstUploads, numFrames,
+		CSceneDrawList::IsMultiDrawIndirectSupported() ? "glMultiDrawElementsIndirect" : "glMultiDrawElementsBaseVertex");
+	printf("Instances uploaded on %d of %d frames for coins, %d for tyres\n", pScene->coinInstances.GetUploads() - firstCoinUploads,
+		numFrames, pScene->tyreInstances.GetUploads() - firstTyreUploads);
+	printf("GL state calls per frame: %.1f issued, %.1f skipped\n", stateIssued / n, stateSkipped / n);
+	printf("Track lights: %d, where the old shader stopped at 16\n", (int)pScene->lights.size());
+	printf("Light clusters checked on %d frames, %d fragments: %.1f lights in range per fragment (%d max), %.1f evaluated, %d missed\n",
+		lightCheck.frames, lightCheck.fragments, lightCheck.lightsInRange / glm::max(lightCheck.fragments, 1), lightCheck.maxLightsInRange,
+		lightCheck.lightsEvaluated / glm::max(lightCheck.fragments, 1), lightCheck.missed);
+	GeometryArenaStats arenaStats = CGeometryArena::GetStats();
+	printf("Geometry arena: %d ranges in %d buffers and %d VAOs, %d KB used of %d KB\n", arenaStats.allocations, arenaStats.buffers,
+		arenaStats.vertexArrays, (int)(arenaStats.bytesUsed / 1024), (int)(arenaStats.bytesReserved / 1024));
+
+	// Smoothed over the last few frames, so this is the end of the lap rather than the whole run
+	const CGpuTimer& gpuTimer = pScene->gpuTimer;
+	if (gpuTimer.IsSupported()) {
+		printf("\nGPU ms at the end of the run: frame %.3f", gpuTimer.GetFrameTime());
+		const GpuPass passes[] = { GPU_PASS_TERRAIN, GPU_PASS_COINS, GPU_PASS_TYRES, GPU_PASS_TRACK };
+		for (int i = 0; i < 4; i++)
+			printf(", %s %.3f", CGpuTimer::GetPassName(passes[i]), gpuTimer.GetPassTime(passes[i]));
+		printf(" (%d frames dropped)\n", gpuTimer.GetDroppedFrames());
+	}
+
+	if (CProfiler::WriteChromeTrace("render_benchmark.json"))
+		printf("Trace written to render_benchmark.json\n");
+
+	pScene->gpuTimer.Release();
+	delete pScene;
+	context.Release();
+	return lightCheck.missed == 0 ? 0 : 1;
+}
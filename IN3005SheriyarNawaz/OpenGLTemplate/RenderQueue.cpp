@@ -0,0 +1,153 @@
+#include "RenderQueue.h"
+#include "Profiler.h"
+#include <string.h>
+#include <algorithm>
+
+static const int PASS_SHIFT = 60;
+static const int PROGRAM_SHIFT = 54;
+static const int MATERIAL_SHIFT = 44;
+static const int MESH_SHIFT = 32;
+
+uint64_t CRenderQueue::MakeKey(RenderPass pass, int program, int material, int mesh, float depth)
+{
+	// The bits of a non-negative float sort in the same order as its value
+	depth = glm::max(depth, 0.0f);
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	return ((uint64_t)pass << PASS_SHIFT) |
+		((uint64_t)(program & (MAX_PROGRAMS - 1)) << PROGRAM_SHIFT) |
+		((uint64_t)(material & (MAX_MATERIALS - 1)) << MATERIAL_SHIFT) |
+		((uint64_t)(mesh & (MAX_MESHES - 1)) << MESH_SHIFT) |
+		depthBits;
+}
+
+float CRenderQueue::GetViewDepth(const glm::vec3& viewPosition, const glm::vec3& centre, float radius)
+{
+	return glm::max(glm::distance(viewPosition, centre) - radius, 0.0f);
+}
+
+CRenderQueue::CRenderQueue()
+{
+	m_pPrograms = NULL;
+	m_pGpuTimer = NULL;
+}
+
+CRenderQueue::~CRenderQueue()
+{
+}
+
+// Looks up the per-draw uniforms of every program once, so drawing never goes through uniform names
+void CRenderQueue::Create(vector<CShaderProgram*>* pPrograms, CGpuTimer* pGpuTimer)
+{
+	m_pPrograms = pPrograms;
+	m_pGpuTimer = pGpuTimer;
+
+	m_uniforms.resize(pPrograms->size());
+	for (size_t i = 0; i < pPrograms->size(); i++) {
+		CShaderProgram* pProgram = (*pPrograms)[i];
+		ProgramUniforms& uniforms = m_uniforms[i];
+		uniforms.modelViewMatrix = pProgram->GetUniformHandle("matrices.modelViewMatrix");
+		uniforms.normalMatrix = pProgram->GetUniformHandle("matrices.normalMatrix");
+		uniforms.Ma = pProgram->GetUniformHandle("material1.Ma");
+		uniforms.Md = pProgram->GetUniformHandle("material1.Md");
+		uniforms.Ms = pProgram->GetUniformHandle("material1.Ms");
+		uniforms.shininess = pProgram->GetUniformHandle("material1.shininess");
+		uniforms.spinSpeed = pProgram->GetUniformHandle("animation.spinSpeed");
+		uniforms.wobbleAmount = pProgram->GetUniformHandle("animation.wobbleAmount");
+		uniforms.wobbleSpeed = pProgram->GetUniformHandle("animation.wobbleSpeed");
+		uniforms.instanced = pProgram->GetUniformHandle("bInstanced");
+		uniforms.skybox = pProgram->GetUniformHandle("renderSkybox");
+	}
+}
+
+void CRenderQueue::SetMaterial(int material, const RenderMaterial& values)
+{
+	if (material >= (int)m_materials.size())
+		m_materials.resize(material + 1);
+	m_materials[material] = values;
+}
+
+void CRenderQueue::Submit(const RenderPacket& packet)
+{
+	m_packets.push_back(packet);
+}
+
+void CRenderQueue::ApplyMaterial(CShaderProgram* pProgram, const ProgramUniforms& uniforms, int material)
+{
+	const RenderMaterial& values = m_materials[material];
+	pProgram->SetUniform(uniforms.Ma, values.Ma);
+	pProgram->SetUniform(uniforms.Md, values.Md);
+	pProgram->SetUniform(uniforms.Ms, values.Ms);
+	pProgram->SetUniform(uniforms.shininess, values.shininess);
+	pProgram->SetUniform(uniforms.spinSpeed, values.spinSpeed);
+	pProgram->SetUniform(uniforms.wobbleAmount, values.wobbleAmount);
+	pProgram->SetUniform(uniforms.wobbleSpeed, values.wobbleSpeed);
+}
+
+void CRenderQueue::Execute()
+{
+	PROFILE_ZONE("CRenderQueue::Execute");
+	m_stats = RenderQueueStats();
+	m_stats.packets = (int)m_packets.size();
+
+	m_order.resize(m_packets.size());
+	for (size_t i = 0; i < m_packets.size(); i++) {
+		m_order[i].key = m_packets[i].key;
+		m_order[i].packet = (int)i;
+	}
+	std::sort(m_order.begin(), m_order.end());
+
+	// Uniforms belong to a program, so everything is set again after a program change
+	CShaderProgram* pProgram = NULL;
+	int program = -1, material = -1, instanced = -1, skybox = -1;
+
+	for (size_t i = 0; i < m_order.size(); i++) {
+		const RenderPacket& packet = m_packets[m_order[i].packet];
+
+		int packetProgram = (int)((packet.key >> PROGRAM_SHIFT) & (MAX_PROGRAMS - 1));
+		if (packetProgram != program) {
+			program = packetProgram;
+			pProgram = (*m_pPrograms)[program];
+			pProgram->UseProgram();
+			material = instanced = skybox = -1;
+			m_stats.programChanges++;
+		}
+		const ProgramUniforms& uniforms = m_uniforms[program];
+
+		int packetMaterial = (int)((packet.key >> MATERIAL_SHIFT) & (MAX_MATERIALS - 1));
+		if (packetMaterial != material) {
+			material = packetMaterial;
+			ApplyMaterial(pProgram, uniforms, material);
+			m_stats.materialChanges++;
+		}
+
+		if ((int)packet.instanced != instanced) {
+			instanced = (int)packet.instanced;
+			pProgram->SetUniform(uniforms.instanced, instanced);
+		}
+		if ((int)packet.skybox != skybox) {
+			skybox = (int)packet.skybox;
+			pProgram->SetUniform(uniforms.skybox, skybox);
+		}
+
+		if (!packet.instanced) {
+			pProgram->SetUniform(uniforms.modelViewMatrix, packet.modelViewMatrix);
+			pProgram->SetUniform(uniforms.normalMatrix, glm::transpose(glm::inverse(glm::mat3(packet.modelViewMatrix))));
+		}
+
+		bool timed = m_pGpuTimer != NULL && packet.gpuPass != NUM_GPU_PASSES;
+		if (timed)
+			m_pGpuTimer->BeginPass(packet.gpuPass);
+		packet.draw(packet.pObject, packet.pArgument);
+		if (timed)
+			m_pGpuTimer->EndPass(packet.gpuPass);
+	}
+
+	m_packets.clear();
+}
+
+const RenderQueueStats& CRenderQueue::GetStats() const
+{
+	return m_stats;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Common.h"
+#include "Shaders.h"
+#include "GpuTimer.h"
+#include <stdint.h>
+
+// Passes are drawn in this order.  The sky writes no depth, so it goes first and everything else is drawn over it
+enum RenderPass
+{
+	RENDER_PASS_SKY,
+	RENDER_PASS_OPAQUE,
+	NUM_RENDER_PASSES
+};
+
+// Shader parameters shared by every draw that uses the material.  They are only set when the material changes from one
+// draw to the next
+struct RenderMaterial
+{
+	RenderMaterial() : Ma(0.0f), Md(0.0f), Ms(0.0f), shininess(1.0f), spinSpeed(0.0f), wobbleAmount(0.0f), wobbleSpeed(0.0f) {}
+	RenderMaterial(const glm::vec3& a, const glm::vec3& d, const glm::vec3& s, float shine)
+		: Ma(a), Md(d), Ms(s), shininess(shine), spinSpeed(0.0f), wobbleAmount(0.0f), wobbleSpeed(0.0f) {}
+
+	glm::vec3 Ma, Md, Ms;			// material1 in mainShader.frag
+	float shininess;
+	float spinSpeed;				// animation in mainShader.vert, for instanced draws
+	float wobbleAmount;
+	float wobbleSpeed;
+};
+
+// Issues the draw call for a packet, once the queue has set the program, material and transform
+typedef void (*RenderCallback)(void* pObject, void* pArgument);
+
+// One draw, with everything needed to make it later
+struct RenderPacket
+{
+	RenderPacket() : key(0), draw(NULL), pObject(NULL), pArgument(NULL), modelViewMatrix(1.0f), instanced(false),
+		skybox(false), gpuPass(NUM_GPU_PASSES) {}
+
+	uint64_t key;					// From CRenderQueue::MakeKey
+	RenderCallback draw;
+	void* pObject;
+	void* pArgument;
+	glm::mat4 modelViewMatrix;		// Not used for instanced draws, which take their transforms from the instance buffer
+	bool instanced;					// bInstanced
+	bool skybox;					// renderSkybox
+	GpuPass gpuPass;				// Timed as this pass, or NUM_GPU_PASSES for none
+};
+
+// Draw counts for the last Execute
+struct RenderQueueStats
+{
+	RenderQueueStats() : packets(0), programChanges(0), materialChanges(0) {}
+	int packets;
+	int programChanges;
+	int materialChanges;
+};
+
+// Render functions submit packets here instead of drawing straight away.  Execute sorts the packets by key and draws them
+// once per frame, so draws that share a program, material and mesh are next to each other and each uniform is only set
+// when it changes.  Keys are, from the top bit down:
+//
+//   pass (4 bits) | program (6) | material (10) | mesh (12) | depth (32)
+//
+// Depth is a view distance, so draws with the same state go front to back and the nearer ones can reject fragments of the
+// later ones with early depth testing.  Programs are indexes into the program list given to Create; every program drawn
+// through the queue must declare the per-draw uniforms of mainShader.  The HUD is drawn after Execute, outside the queue.
+class CRenderQueue
+{
+public:
+	static const int MAX_PROGRAMS = 1 << 6;
+	static const int MAX_MATERIALS = 1 << 10;
+	static const int MAX_MESHES = 1 << 12;
+
+	static uint64_t MakeKey(RenderPass pass, int program, int material, int mesh, float depth);
+	static float GetViewDepth(const glm::vec3& viewPosition, const glm::vec3& centre, float radius);	// To the nearest point of a sphere
+
+	CRenderQueue();
+	~CRenderQueue();
+
+	void Create(vector<CShaderProgram*>* pPrograms, CGpuTimer* pGpuTimer = NULL);
+	void SetMaterial(int material, const RenderMaterial& values);
+
+	void Submit(const RenderPacket& packet);
+	void Execute();							// Draws everything submitted since the last Execute, in key order
+
+	const RenderQueueStats& GetStats() const;
+
+private:
+	// Locations of the per-draw uniforms in one program
+	struct ProgramUniforms
+	{
+		UniformHandle modelViewMatrix, normalMatrix;
+		UniformHandle Ma, Md, Ms, shininess;
+		UniformHandle spinSpeed, wobbleAmount, wobbleSpeed;
+		UniformHandle instanced, skybox;
+	};
+
+	// Sorting these rather than the packets themselves moves 16 bytes per swap instead of a whole packet
+	struct SortEntry
+	{
+		uint64_t key;
+		int packet;
+		bool operator<(const SortEntry& other) const { return key < other.key || (key == other.key && packet < other.packet); }
+	};
+
+	void ApplyMaterial(CShaderProgram* pProgram, const ProgramUniforms& uniforms, int material);
+
+	vector<CShaderProgram*>* m_pPrograms;
+	vector<ProgramUniforms> m_uniforms;
+	vector<RenderMaterial> m_materials;
+	CGpuTimer* m_pGpuTimer;
+
+	vector<RenderPacket> m_packets;
+	vector<SortEntry> m_order;
+	RenderQueueStats m_stats;
+};
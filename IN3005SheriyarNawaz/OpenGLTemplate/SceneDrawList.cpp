@@ -0,0 +1,143 @@
+#include "SceneDrawList.h"
+#include <string.h>
+
+// glMultiDrawElementsIndirect is core from OpenGL 4.3; the game asks for 4.0, so older drivers may only have the extension
+static bool HasMultiDrawIndirect()
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 3))
+		return true;
+
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (GLint i = 0; i < numExtensions; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension != NULL && strcmp(extension, "GL_ARB_multi_draw_indirect") == 0)
+			return true;
+	}
+	return false;
+}
+
+// Asked once, on the first call, which needs a current GL context
+bool CSceneDrawList::IsMultiDrawIndirectSupported()
+{
+	static bool supported = HasMultiDrawIndirect();
+	return supported;
+}
+
+CSceneDrawList::CSceneDrawList()
+{
+	m_format = VERTEX_FORMAT_MESH;
+	m_indirectBuffer = 0;
+	m_indirectCapacity = 0;
+	m_uploads = 0;
+}
+
+CSceneDrawList::~CSceneDrawList()
+{
+}
+
+void CSceneDrawList::Create()
+{
+	glGenBuffers(1, &m_indirectBuffer);
+}
+
+void CSceneDrawList::Release()
+{
+	if (m_indirectBuffer == 0)
+		return;
+
+	glDeleteBuffers(1, &m_indirectBuffer);
+	m_indirectBuffer = 0;
+	m_indirectCapacity = 0;
+	m_uploaded.clear();
+}
+
+void CSceneDrawList::Clear()
+{
+	m_commands.clear();
+}
+
+void CSceneDrawList::Add(const GeometryRange& range)
+{
+	Add(range, 0, range.indexCount);
+}
+
+void CSceneDrawList::Add(const GeometryRange& range, GLuint firstIndex, GLsizei indexCount)
+{
+	if (indexCount <= 0)
+		return;
+
+	m_format = range.format;
+	GLuint first = range.firstIndex + firstIndex;
+	if (!m_commands.empty()) {
+		DrawElementsIndirectCommand& last = m_commands.back();
+		if (last.baseVertex == range.baseVertex && last.firstIndex + last.count == first) {
+			last.count += indexCount;
+			return;
+		}
+	}
+
+	DrawElementsIndirectCommand command;
+	command.count = indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = first;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = 0;
+	m_commands.push_back(command);
+}
+
+void CSceneDrawList::Render()
+{
+	if (m_commands.empty())
+		return;
+
+	bool indirect = IsMultiDrawIndirectSupported();
+	size_t size = m_commands.size() * sizeof(DrawElementsIndirectCommand);
+	bool changed = m_commands.size() != m_uploaded.size() || memcmp(&m_commands[0], &m_uploaded[0], size) != 0;
+
+	if (indirect)
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+
+	if (changed) {
+		if (indirect) {
+			// The buffer only grows, so a list that shrinks and grows again within its old size is a plain update
+			if ((GLsizeiptr)size > m_indirectCapacity) {
+				m_indirectCapacity = (GLsizeiptr)size;
+				glBufferData(GL_DRAW_INDIRECT_BUFFER, m_indirectCapacity, &m_commands[0], GL_DYNAMIC_DRAW);
+			}
+			else
+				glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, &m_commands[0]);
+		}
+		else {
+			m_counts.resize(m_commands.size());
+			m_offsets.resize(m_commands.size());
+			m_baseVertices.resize(m_commands.size());
+			for (size_t i = 0; i < m_commands.size(); i++) {
+				m_counts[i] = m_commands[i].count;
+				m_offsets[i] = (GLvoid*)(m_commands[i].firstIndex * sizeof(GLuint));
+				m_baseVertices[i] = m_commands[i].baseVertex;
+			}
+		}
+		m_uploaded = m_commands;
+		m_uploads++;
+	}
+
+	CGeometryArena::Bind(m_format);
+	if (indirect)
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)m_commands.size(), 0);
+	else
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, &m_counts[0], GL_UNSIGNED_INT, &m_offsets[0], (GLsizei)m_commands.size(), &m_baseVertices[0]);
+}
+
+int CSceneDrawList::GetNumDraws() const
+{
+	return (int)m_commands.size();
+}
+
+int CSceneDrawList::GetUploads() const
+{
+	return m_uploads;
+}
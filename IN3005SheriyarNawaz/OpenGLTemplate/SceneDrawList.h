@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Common.h"
+#include "GeometryArena.h"
+
+// The command layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Index ranges in the geometry arena that are drawn together with one call.  They must share a vertex format, but can
+// belong to any number of meshes.  The list is rebuilt with Clear and Add whenever the caller likes, but the commands are
+// only written to the GPU when they differ from the last ones drawn, so a view that sees the same ranges as last frame
+// costs no upload.  Without glMultiDrawElementsIndirect the same ranges are drawn with glMultiDrawElementsBaseVertex,
+// which is still one call
+class CSceneDrawList
+{
+public:
+	static bool IsMultiDrawIndirectSupported();	// OpenGL 4.3 or ARB_multi_draw_indirect
+
+	CSceneDrawList();
+	~CSceneDrawList();
+
+	void Create();
+	void Release();
+
+	void Clear();
+	void Add(const GeometryRange& range);
+	void Add(const GeometryRange& range, GLuint firstIndex, GLsizei indexCount);	// Part of a range, from its own first index.  Joins onto the last range if it follows on from it
+	void Render();
+
+	int GetNumDraws() const;
+	int GetUploads() const;					// Times the commands have been written to the GPU
+
+private:
+	VertexFormat m_format;
+	vector<DrawElementsIndirectCommand> m_commands;
+	vector<DrawElementsIndirectCommand> m_uploaded;		// What the GPU buffer or the arrays below hold
+	GLuint m_indirectBuffer;
+	GLsizeiptr m_indirectCapacity;
+	int m_uploads;
+
+	// For glMultiDrawElementsBaseVertex
+	vector<GLsizei> m_counts;
+	vector<GLvoid*> m_offsets;
+	vector<GLint> m_baseVertices;
+};
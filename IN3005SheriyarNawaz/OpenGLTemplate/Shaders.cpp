@@ -1,5 +1,6 @@
 #include "Common.h"
-#include "shaders.h"
+#include "Shaders.h"
+#include "GLStateCache.h"
 
 
 
@@ -147,6 +148,8 @@ void CShader::DeleteShader()
 CShaderProgram::CShaderProgram()
 {
 	m_bLinked = false;
+	m_iUncachedLookups = 0;
+	m_iMissingLookups = 0;
 }
 
 // Creates a new shader program
@@ -185,23 +188,109 @@ bool CShaderProgram::LinkProgram()
 	}
 
 	m_bLinked = iLinkStatus == GL_TRUE;
+	if (m_bLinked)
+		CacheUniformLocations();
 	return m_bLinked;
 }
 
+// Looks up the location of every active uniform once, so SetUniform doesn't have to ask OpenGL each time
+void CShaderProgram::CacheUniformLocations()
+{
+	m_uniformLocations.clear();
+
+	int iNumUniforms = 0, iMaxLength = 0;
+	glGetProgramiv(m_uiProgram, GL_ACTIVE_UNIFORMS, &iNumUniforms);
+	glGetProgramiv(m_uiProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &iMaxLength);
+
+	vector<char> sNameBuffer(iMaxLength + 1);
+	for (int i = 0; i < iNumUniforms; i++) {
+		GLsizei iLength = 0;
+		GLint iSize = 0;
+		GLenum eType;
+		glGetActiveUniform(m_uiProgram, i, (GLsizei)sNameBuffer.size(), &iLength, &iSize, &eType, &sNameBuffer[0]);
+
+		string sName(&sNameBuffer[0], iLength);
+		GLint iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+		if (iLoc < 0)
+			continue; // Members of uniform blocks have no location
+
+		m_uniformLocations[sName] = iLoc;
+
+		// Arrays of basic types are listed once as "name[0]".  Add the bare name and the remaining elements too
+		if (sName.size() > 3 && sName.compare(sName.size() - 3, 3, "[0]") == 0) {
+			string sBase = sName.substr(0, sName.size() - 3);
+			m_uniformLocations[sBase] = iLoc;
+			for (int j = 1; j < iSize; j++) {
+				string sElement = sBase + "[" + to_string(j) + "]";
+				m_uniformLocations[sElement] = glGetUniformLocation(m_uiProgram, sElement.c_str());
+			}
+		}
+	}
+}
+
+// Returns a handle for the named uniform.  Every call is counted, so the counter shows string lookups creeping into the
+// frame.  Names that are not active (unused or misspelt) are asked of OpenGL once and remembered as -1, but are counted
+// as missing every time they are looked up
+UniformHandle CShaderProgram::GetUniformHandle(const string& sName)
+{
+	UniformHandle hUniform;
+	m_iUncachedLookups++;
+
+	unordered_map<string, GLint>::const_iterator it = m_uniformLocations.find(sName);
+	if (it != m_uniformLocations.end()) {
+		hUniform.location = it->second;
+	}
+	else {
+		hUniform.location = glGetUniformLocation(m_uiProgram, sName.c_str());
+		m_uniformLocations[sName] = hUniform.location;
+	}
+
+	if (hUniform.location < 0)
+		m_iMissingLookups++;
+	return hUniform;
+}
+
+int CShaderProgram::GetUncachedLookupCount()
+{
+	return m_iUncachedLookups;
+}
+
+int CShaderProgram::GetMissingLookupCount()
+{
+	return m_iMissingLookups;
+}
+
+void CShaderProgram::ResetUncachedLookupCount()
+{
+	m_iUncachedLookups = 0;
+	m_iMissingLookups = 0;
+}
+
+// Attaches the named uniform block to a binding point.  Returns false if the program doesn't use the block
+bool CShaderProgram::BindUniformBlock(const string& sBlockName, UINT uiBindingPoint)
+{
+	GLuint uiBlockIndex = glGetUniformBlockIndex(m_uiProgram, sBlockName.c_str());
+	if (uiBlockIndex == GL_INVALID_INDEX)
+		return false;
+
+	glUniformBlockBinding(m_uiProgram, uiBlockIndex, uiBindingPoint);
+	return true;
+}
+
 // Deletes the program and frees memory on the GPU
 void CShaderProgram::DeleteProgram()
 {
 	if(!m_bLinked)
 		return;
 	m_bLinked = false;
-	glDeleteProgram(m_uiProgram);
+	CGLStateCache::DeleteProgram(m_uiProgram);
 }
 
 // Instructs OpenGL to use this program
 void CShaderProgram::UseProgram()
 {
 	if(m_bLinked)
-		glUseProgram(m_uiProgram);
+		CGLStateCache::UseProgram(m_uiProgram);
 }
 
 // Returns the OpenGL program ID
@@ -210,98 +299,154 @@ UINT CShaderProgram::GetProgramID()
 	return m_uiProgram;
 }
 
-// A collection of functions to set uniform variables inside shaders
+// A collection of functions to set uniform variables inside shaders.  The string versions go through the location cache
 
 // Setting floats
 
 void CShaderProgram::SetUniform(string sName, float* fValues, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform1fv(iLoc, iCount, fValues);
+	SetUniform(GetUniformHandle(sName), fValues, iCount);
 }
 
 void CShaderProgram::SetUniform(string sName, const float fValue)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform1fv(iLoc, 1, &fValue);
+	SetUniform(GetUniformHandle(sName), fValue);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, float* fValues, int iCount)
+{
+	glUniform1fv(hUniform.location, iCount, fValues);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, const float fValue)
+{
+	glUniform1fv(hUniform.location, 1, &fValue);
 }
 
 // Setting vectors
 
 void CShaderProgram::SetUniform(string sName, glm::vec2* vVectors, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform2fv(iLoc, iCount, (GLfloat*)vVectors);
+	SetUniform(GetUniformHandle(sName), vVectors, iCount);
 }
 
 void CShaderProgram::SetUniform(string sName, const glm::vec2 vVector)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform2fv(iLoc, 1, (GLfloat*)&vVector);
+	SetUniform(GetUniformHandle(sName), vVector);
 }
 
 void CShaderProgram::SetUniform(string sName, glm::vec3* vVectors, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform3fv(iLoc, iCount, (GLfloat*)vVectors);
+	SetUniform(GetUniformHandle(sName), vVectors, iCount);
 }
 
 void CShaderProgram::SetUniform(string sName, const glm::vec3 vVector)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform3fv(iLoc, 1, (GLfloat*)&vVector);
+	SetUniform(GetUniformHandle(sName), vVector);
 }
 
 void CShaderProgram::SetUniform(string sName, glm::vec4* vVectors, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform4fv(iLoc, iCount, (GLfloat*)vVectors);
+	SetUniform(GetUniformHandle(sName), vVectors, iCount);
 }
 
 void CShaderProgram::SetUniform(string sName, const glm::vec4 vVector)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform4fv(iLoc, 1, (GLfloat*)&vVector);
+	SetUniform(GetUniformHandle(sName), vVector);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, glm::vec2* vVectors, int iCount)
+{
+	glUniform2fv(hUniform.location, iCount, (GLfloat*)vVectors);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, const glm::vec2 vVector)
+{
+	glUniform2fv(hUniform.location, 1, (GLfloat*)&vVector);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, glm::vec3* vVectors, int iCount)
+{
+	glUniform3fv(hUniform.location, iCount, (GLfloat*)vVectors);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, const glm::vec3 vVector)
+{
+	glUniform3fv(hUniform.location, 1, (GLfloat*)&vVector);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, glm::vec4* vVectors, int iCount)
+{
+	glUniform4fv(hUniform.location, iCount, (GLfloat*)vVectors);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, const glm::vec4 vVector)
+{
+	glUniform4fv(hUniform.location, 1, (GLfloat*)&vVector);
 }
 
 // Setting 3x3 matrices
 
 void CShaderProgram::SetUniform(string sName, glm::mat3* mMatrices, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniformMatrix3fv(iLoc, iCount, FALSE, (GLfloat*)mMatrices);
+	SetUniform(GetUniformHandle(sName), mMatrices, iCount);
 }
 
 void CShaderProgram::SetUniform(string sName, const glm::mat3 mMatrix)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniformMatrix3fv(iLoc, 1, FALSE, (GLfloat*)&mMatrix);
+	SetUniform(GetUniformHandle(sName), mMatrix);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, glm::mat3* mMatrices, int iCount)
+{
+	glUniformMatrix3fv(hUniform.location, iCount, FALSE, (GLfloat*)mMatrices);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, const glm::mat3 mMatrix)
+{
+	glUniformMatrix3fv(hUniform.location, 1, FALSE, (GLfloat*)&mMatrix);
 }
 
 // Setting 4x4 matrices
 
 void CShaderProgram::SetUniform(string sName, glm::mat4* mMatrices, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniformMatrix4fv(iLoc, iCount, FALSE, (GLfloat*)mMatrices);
+	SetUniform(GetUniformHandle(sName), mMatrices, iCount);
 }
 
 void CShaderProgram::SetUniform(string sName, const glm::mat4 mMatrix)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniformMatrix4fv(iLoc, 1, FALSE, (GLfloat*)&mMatrix);
+	SetUniform(GetUniformHandle(sName), mMatrix);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, glm::mat4* mMatrices, int iCount)
+{
+	glUniformMatrix4fv(hUniform.location, iCount, FALSE, (GLfloat*)mMatrices);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, const glm::mat4 mMatrix)
+{
+	glUniformMatrix4fv(hUniform.location, 1, FALSE, (GLfloat*)&mMatrix);
 }
 
 // Setting integers
 
 void CShaderProgram::SetUniform(string sName, int* iValues, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform1iv(iLoc, iCount, iValues);
+	SetUniform(GetUniformHandle(sName), iValues, iCount);
 }
 
 void CShaderProgram::SetUniform(string sName, const int iValue)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
-	glUniform1i(iLoc, iValue);
+	SetUniform(GetUniformHandle(sName), iValue);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, int* iValues, int iCount)
+{
+	glUniform1iv(hUniform.location, iCount, iValues);
+}
+
+void CShaderProgram::SetUniform(UniformHandle hUniform, const int iValue)
+{
+	glUniform1i(hUniform.location, iValue);
 }
\ No newline at end of file
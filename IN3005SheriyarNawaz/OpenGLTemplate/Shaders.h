@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Common.h"
+#include <unordered_map>
 
 
 // A class that provides a wrapper around an OpenGL shader
@@ -26,6 +27,13 @@ private:
 };
 
 
+// Location of a uniform in a linked program.  Look it up once with GetUniformHandle and reuse it every frame
+struct UniformHandle
+{
+	UniformHandle() : location(-1) {}
+	GLint location;
+};
+
 // A class the provides a wrapper around an OpenGL shader program
 class CShaderProgram
 {
@@ -42,6 +50,15 @@ public:
 
 	UINT GetProgramID();
 
+	// Uniform locations are cached after linking.  Handles skip the name lookup altogether
+	UniformHandle GetUniformHandle(const string& sName);
+	int GetUncachedLookupCount();			// Lookups by name rather than by handle since the last reset, cache hits included
+	int GetMissingLookupCount();			// Of those, names the program doesn't have (unused or misspelt)
+	void ResetUncachedLookupCount();
+
+	// Connects a uniform block in this program to a UBO binding point (GLSL 4.0 has no binding layout qualifier)
+	bool BindUniformBlock(const string& sBlockName, UINT uiBindingPoint);
+
 	// Setting vectors
 	void SetUniform(string sName, glm::vec2* vVectors, int iCount = 1);
 	void SetUniform(string sName, const glm::vec2 vVector);
@@ -66,8 +83,29 @@ public:
 	void SetUniform(string sName, int* iValues, int iCount = 1);
 	void SetUniform(string sName, const int iValue);
 
+	// Handle versions of the above
+	void SetUniform(UniformHandle hUniform, glm::vec2* vVectors, int iCount = 1);
+	void SetUniform(UniformHandle hUniform, const glm::vec2 vVector);
+	void SetUniform(UniformHandle hUniform, glm::vec3* vVectors, int iCount = 1);
+	void SetUniform(UniformHandle hUniform, const glm::vec3 vVector);
+	void SetUniform(UniformHandle hUniform, glm::vec4* vVectors, int iCount = 1);
+	void SetUniform(UniformHandle hUniform, const glm::vec4 vVector);
+	void SetUniform(UniformHandle hUniform, float* fValues, int iCount = 1);
+	void SetUniform(UniformHandle hUniform, const float fValue);
+	void SetUniform(UniformHandle hUniform, glm::mat3* mMatrices, int iCount = 1);
+	void SetUniform(UniformHandle hUniform, const glm::mat3 mMatrix);
+	void SetUniform(UniformHandle hUniform, glm::mat4* mMatrices, int iCount = 1);
+	void SetUniform(UniformHandle hUniform, const glm::mat4 mMatrix);
+	void SetUniform(UniformHandle hUniform, int* iValues, int iCount = 1);
+	void SetUniform(UniformHandle hUniform, const int iValue);
+
 
 private:
+	void CacheUniformLocations();
+
 	UINT m_uiProgram; // ID of program
 	bool m_bLinked; // Whether program was linked and is ready to use
+	unordered_map<string, GLint> m_uniformLocations; // Uniform name -> location, filled in after linking
+	int m_iUncachedLookups; // Names looked up since the last reset
+	int m_iMissingLookups; // Names looked up since the last reset that have no location
 };
\ No newline at end of file
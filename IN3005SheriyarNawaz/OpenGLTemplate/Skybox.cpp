@@ -1,6 +1,7 @@
 #include "Common.h"
 
 #include "skybox.h"
+#include "GLStateCache.h"
 
 
 CSkybox::CSkybox()
@@ -20,12 +21,8 @@ void CSkybox::Create(float size)
 
 	
 	
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
-
 	m_vbo.Create();
-	m_vbo.Bind();
-
+	m_vbo.Reserve(24);
 
 	glm::vec3 vSkyBoxVertices[24] = 
 	{
@@ -59,39 +56,24 @@ void CSkybox::Create(float size)
 
 	glm::vec4 vColour = glm::vec4(1, 1, 1, 1);
 	for (int i = 0; i < 24; i++) {
-		m_vbo.AddData(&vSkyBoxVertices[i], sizeof(glm::vec3));
-		m_vbo.AddData(&vSkyBoxTexCoords[i%4], sizeof(glm::vec2));
-		m_vbo.AddData(&vSkyBoxNormals[i/4], sizeof(glm::vec3));
+		m_vbo.AddVertex(MeshVertex(vSkyBoxVertices[i], vSkyBoxTexCoords[i%4], vSkyBoxNormals[i/4]));
 	}
 
-	m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
-
-	// Set the vertex attribute locations
-	GLsizei istride = 2*sizeof(glm::vec3)+sizeof(glm::vec2);
-
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, istride, 0);
-	// Texture coordinates
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, istride, (void*)sizeof(glm::vec3));
-	// Normal vectors
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, istride, (void*)(sizeof(glm::vec3)+sizeof(glm::vec2)));
-	
+	m_vbo.UploadDataToGPU();
 }
 
 // Render the skybox
 void CSkybox::Render()
 {
-	glDepthMask(0);
-	glBindVertexArray(m_vao);
+	CGLStateCache::DepthMask(false);
+	m_vbo.Bind();
 	m_cubemapTexture.Bind(1);
+	GLint first = m_vbo.GetRange().baseVertex;
 	for (int i = 0; i < 6; i++) {
 		//m_textures[i].Bind();
-		glDrawArrays(GL_TRIANGLE_STRIP, i*4, 4);
+		glDrawArrays(GL_TRIANGLE_STRIP, first + i*4, 4);
 	}
-	glDepthMask(1);
+	CGLStateCache::DepthMask(true);
 }
 
 // Release the storage assocaited with the skybox
@@ -100,6 +82,5 @@ void CSkybox::Release()
 	//for (int i = 0; i < 6; i++)
 		//m_textures[i].Release();
 	m_cubemapTexture.Release();
-	glDeleteVertexArrays(1, &m_vao);
 	m_vbo.Release();
 }
\ No newline at end of file
@@ -15,7 +15,6 @@ public:
 	void Release();
 
 private:
-	UINT m_vao;
 	CVertexBufferObject m_vbo;
 	CCubemap m_cubemapTexture;
 	
@@ -27,12 +27,8 @@ void CSphere::Create(string a_sDirectory, string a_sFilename, int slicesIn, int
 	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
 	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
 	
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
-
 	m_vbo.Create();
-	m_vbo.Bind();
-	
+	m_vbo.Reserve(stacksIn * (slicesIn+1), 6 * stacksIn * slicesIn);
 
 	// Compute vertex attributes and store in VBO
 	int vertexCount = 0;
@@ -45,9 +41,7 @@ void CSphere::Create(string a_sDirectory, string a_sFilename, int slicesIn, int
 			glm::vec2 t = glm::vec2(slices / (float) slicesIn, stacks / (float) stacksIn);
 			glm::vec3 n = v;
 
-			m_vbo.AddVertexData(&v, sizeof(glm::vec3));
-			m_vbo.AddVertexData(&t, sizeof(glm::vec2));
-			m_vbo.AddVertexData(&n, sizeof(glm::vec3));
+			m_vbo.AddVertex(MeshVertex(v, t, n));
 
 			vertexCount++;
 
@@ -66,41 +60,25 @@ void CSphere::Create(string a_sDirectory, string a_sFilename, int slicesIn, int
 			unsigned int index2 = stacks * (slicesIn+1) + nextSlice;
 			unsigned int index3 = nextStack * (slicesIn+1) + nextSlice;
 
-			m_vbo.AddIndexData(&index0, sizeof(unsigned int));
-			m_vbo.AddIndexData(&index1, sizeof(unsigned int));
-			m_vbo.AddIndexData(&index2, sizeof(unsigned int));
+			m_vbo.AddTriangle(index0, index1, index2);
 			m_numTriangles++;
 
-			m_vbo.AddIndexData(&index2, sizeof(unsigned int));
-			m_vbo.AddIndexData(&index1, sizeof(unsigned int));
-			m_vbo.AddIndexData(&index3, sizeof(unsigned int));
+			m_vbo.AddTriangle(index2, index1, index3);
 			m_numTriangles++;
 
 		}
 	}
 
-	m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
-
-	GLsizei stride = 2*sizeof(glm::vec3)+sizeof(glm::vec2);
-
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-	// Texture coordinates
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-	// Normal vectors
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3)+sizeof(glm::vec2)));
-	
+	m_vbo.UploadDataToGPU();
 }
 
 // Render the sphere as a set of triangles
 void CSphere::Render()
 {
-	glBindVertexArray(m_vao);
+	const GeometryRange& range = m_vbo.GetRange();
+	m_vbo.Bind();
 	m_texture.Bind();
-	glDrawElements(GL_TRIANGLES, m_numTriangles*3, GL_UNSIGNED_INT, 0);
+	glDrawElementsBaseVertex(GL_TRIANGLES, m_numTriangles*3, GL_UNSIGNED_INT, range.GetIndexOffset(), range.baseVertex);
 
 }
 
@@ -108,6 +86,5 @@ void CSphere::Render()
 void CSphere::Release()
 {
 	m_texture.Release();
-	glDeleteVertexArrays(1, &m_vao);
 	m_vbo.Release();
 }
\ No newline at end of file
@@ -13,7 +13,6 @@ public:
 	void Render();
 	void Release();
 private:
-	UINT m_vao;
 	CVertexBufferObjectIndexed m_vbo;
 	CTexture m_texture;
 	string m_directory;
@@ -0,0 +1,128 @@
+/*
+ Spline lookup micro-benchmark.  Builds the track centreline with 500, 5,000 and 50,000 control points and measures how
+ many CCatmullRom::Sample calls per second each arc-length search manages: a linear scan of the table, a binary search
+ of it, and the uniform bucket index the game uses.  Distances are random, so the cursor gives no help, and every search
+ must return the same points.  SampleMany must also agree with Sample, on distances within a lap, beyond it and before
+ the start.
+
+ Not part of the Windows build (it has its own main).  On Linux, from this directory:
+
+   g++ -O2 -std=c++17 -I. SplineBenchmark.cpp CatmullRom.cpp -o spline_benchmark
+
+ Usage: spline_benchmark [seconds per measurement]
+*/
+
+#include "CatmullRom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+static const int NUM_DISTANCES = 4096;		// Cycled through, so the distances stay in cache and the search is what is timed
+static const int BATCH = 1024;				// Samples between checks of the clock
+
+struct Measurement
+{
+	double samplesPerSecond;
+	glm::vec3 checksum;						// Sum of the first pass over the distances, to compare the searches
+};
+
+static Measurement Measure(CCatmullRom& spline, SegmentSearch search, const vector<float>& distances, double seconds)
+{
+	spline.SetSegmentSearch(search);
+
+	Measurement result;
+	result.checksum = glm::vec3(0.0f);
+	glm::vec3 p;
+	for (int i = 0; i < NUM_DISTANCES; i++) {
+		spline.Sample(distances[i], p);
+		result.checksum += p;
+	}
+
+	// Whole batches until the time is up, so even the slowest search gets a few
+	long long samples = 0;
+	glm::vec3 sink(0.0f);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	double elapsed = 0.0;
+	int next = 0;
+	while (elapsed < seconds) {
+		for (int i = 0; i < BATCH; i++) {
+			spline.Sample(distances[next], p);
+			sink += p;
+			next = (next + 1) % NUM_DISTANCES;
+		}
+		samples += BATCH;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Keeps the loop from being optimised away
+	if (sink.x == 12345.0f)
+		printf(" ");
+
+	result.samplesPerSecond = samples / elapsed;
+	return result;
+}
+
+// SampleMany evaluates the segment cubics in SIMD registers where Sample blends the control points, so the two only
+// agree to rounding
+static bool CheckSampleMany(CCatmullRom& spline, const vector<float>& distances)
+{
+	float length = spline.GetTrackLength();
+	vector<float> checked(distances.begin(), distances.begin() + 100);
+	const float laps[] = { 0.0f, 1.0f, 1.5f, 3.25f, 10.0f };
+	for (int i = 0; i < 5; i++)
+		checked.push_back(length * laps[i]);
+
+	vector<glm::vec3> points(checked.size());
+	if (!spline.SampleMany(&checked[0], checked.size(), &points[0]))
+		return false;
+
+	glm::vec3 p;
+	for (size_t i = 0; i < checked.size(); i++) {
+		if (!spline.Sample(checked[i], p) || glm::distance(p, points[i]) > 1.0e-3f * length)
+			return false;
+	}
+
+	// Out of range for Sample, so for SampleMany too, wherever it is in the batch
+	checked[50] = -1.0f;
+	return !spline.Sample(checked[50], p) && !spline.SampleMany(&checked[0], checked.size(), &points[0]);
+}
+
+int main(int argc, char** argv)
+{
+	double seconds = 0.5;
+	if (argc > 1)
+		seconds = atof(argv[1]);
+
+	const int sizes[] = { 500, 5000, 50000 };
+	const SegmentSearch searches[] = { SEGMENT_SEARCH_LINEAR, SEGMENT_SEARCH_BINARY, SEGMENT_SEARCH_BUCKETS };
+
+	printf("%-16s %14s %14s %14s\n", "M samples/s", "linear", "binary", "buckets");
+	bool identical = true;
+	bool agreed = true;
+	for (int s = 0; s < 3; s++) {
+		CCatmullRom spline;
+		spline.CreateCentreline(sizes[s]);
+
+		vector<float> distances(NUM_DISTANCES);
+		srand(1);
+		for (int i = 0; i < NUM_DISTANCES; i++)
+			distances[i] = spline.GetTrackLength() * rand() / (float)RAND_MAX;
+
+		if (!CheckSampleMany(spline, distances))
+			agreed = false;
+
+		Measurement results[3];
+		for (int m = 0; m < 3; m++) {
+			results[m] = Measure(spline, searches[m], distances, seconds);
+			if (results[m].checksum != results[0].checksum)
+				identical = false;
+		}
+
+		printf("%-6d points    %14.2f %14.2f %14.2f\n", sizes[s], results[0].samplesPerSecond / 1.0e6,
+			results[1].samplesPerSecond / 1.0e6, results[2].samplesPerSecond / 1.0e6);
+	}
+
+	printf(identical ? "All searches returned the same points\n" : "The searches returned different points\n");
+	printf(agreed ? "SampleMany agreed with Sample\n" : "SampleMany and Sample disagreed\n");
+	return identical && agreed ? 0 : 1;
+}
@@ -1,8 +1,9 @@
 #include "Common.h"
 
-#include "texture.h"
+#include "Texture.h"
+#include "GLStateCache.h"
 
-#include "include\freeimage\FreeImage.h"
+#include "include/freeimage/FreeImage.h"
 #pragma comment(lib, "lib/FreeImage.lib")
 
 CTexture::CTexture()
@@ -17,7 +18,7 @@ void CTexture::CreateFromData(BYTE* data, int width, int height, int bpp, GLenum
 {
 	// Generate an OpenGL texture ID for this texture
 	glGenTextures(1, &m_textureID);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
+	CGLStateCache::BindTexture(0, GL_TEXTURE_2D, m_textureID);
 	if(format == GL_RGBA || format == GL_BGRA)
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 	// We must handle this because of internal format parameter
@@ -94,16 +95,15 @@ void CTexture::SetSamplerObjectParameterf(GLenum parameter, float value)
 // Binds a texture for rendering
 void CTexture::Bind(int iTextureUnit)
 {
-	glActiveTexture(GL_TEXTURE0+iTextureUnit);
-	glBindTexture(GL_TEXTURE_2D, m_textureID);
-	glBindSampler(iTextureUnit, m_samplerObjectID);
+	CGLStateCache::BindTexture(iTextureUnit, GL_TEXTURE_2D, m_textureID);
+	CGLStateCache::BindSampler(iTextureUnit, m_samplerObjectID);
 }
 
 // Frees memory on the GPU of the texture
 void CTexture::Release()
 {
-	glDeleteSamplers(1, &m_samplerObjectID);
-	glDeleteTextures(1, &m_textureID);
+	CGLStateCache::DeleteSampler(m_samplerObjectID);
+	CGLStateCache::DeleteTexture(m_textureID);
 }
 
 int CTexture::GetWidth()
@@ -0,0 +1,63 @@
+#include "TrackBroadphase.h"
+
+CTrackBroadphase::CTrackBroadphase()
+{
+	m_trackLength = 0.0f;
+	m_bucketLength = 1.0f;
+	m_numBuckets = 0;
+}
+
+CTrackBroadphase::~CTrackBroadphase()
+{
+}
+
+// Sort the objects into buckets with a counting sort, so each bucket is a contiguous run of m_objects
+void CTrackBroadphase::Build(const vector<float>& distances, float trackLength, float bucketLength)
+{
+	m_trackLength = trackLength;
+	m_numBuckets = glm::max(1, (int)ceil(trackLength / bucketLength));
+	m_bucketLength = trackLength / m_numBuckets;
+
+	m_bucketStarts.assign(m_numBuckets + 1, 0);
+	for (size_t i = 0; i < distances.size(); i++)
+		m_bucketStarts[BucketIndex(distances[i]) + 1]++;
+	for (int b = 0; b < m_numBuckets; b++)
+		m_bucketStarts[b + 1] += m_bucketStarts[b];
+
+	vector<int> next(m_bucketStarts.begin(), m_bucketStarts.end() - 1);
+	m_objects.resize(distances.size());
+	for (size_t i = 0; i < distances.size(); i++)
+		m_objects[next[BucketIndex(distances[i])]++] = (int)i;
+}
+
+void CTrackBroadphase::Query(float distance, float range, vector<int>& candidates) const
+{
+	if (m_numBuckets == 0 || m_objects.empty())
+		return;
+
+	// Buckets overlapping [distance - range, distance + range], taken modulo the lap
+	int first = (int)floor((distance - range) / m_bucketLength);
+	int last = (int)floor((distance + range) / m_bucketLength);
+	if (last - first + 1 > m_numBuckets)
+		last = first + m_numBuckets - 1;
+
+	for (int b = first; b <= last; b++) {
+		int bucket = ((b % m_numBuckets) + m_numBuckets) % m_numBuckets;
+		for (int i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1]; i++)
+			candidates.push_back(m_objects[i]);
+	}
+}
+
+int CTrackBroadphase::GetNumObjects() const
+{
+	return (int)m_objects.size();
+}
+
+// Bucket containing a distance, wrapped into one lap
+int CTrackBroadphase::BucketIndex(float distance) const
+{
+	float d = fmod(distance, m_trackLength);
+	if (d < 0.0f)
+		d += m_trackLength;
+	return glm::min((int)(d / m_bucketLength), m_numBuckets - 1);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "CommonCore.h"
+
+// Objects placed along the track, bucketed by their distance along the centreline.  A query only visits the buckets
+// around the given distance, so its cost depends on how crowded that part of the track is, not on the total number
+// of objects.  Distances wrap round at the end of the lap.
+class CTrackBroadphase
+{
+public:
+	CTrackBroadphase();
+	~CTrackBroadphase();
+
+	void Build(const vector<float>& distances, float trackLength, float bucketLength);	// Object i is at distances[i]
+	void Query(float distance, float range, vector<int>& candidates) const;				// Appends every object within range of distance (and possibly a few more)
+
+	int GetNumObjects() const;
+
+private:
+	int BucketIndex(float distance) const;
+
+	float m_trackLength;
+	float m_bucketLength;
+	int m_numBuckets;
+	vector<int> m_bucketStarts;		// Objects in bucket b are m_objects[m_bucketStarts[b]] to m_objects[m_bucketStarts[b + 1] - 1]
+	vector<int> m_objects;			// Object indices, sorted by bucket
+};
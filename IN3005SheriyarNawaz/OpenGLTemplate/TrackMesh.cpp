@@ -0,0 +1,280 @@
+#include "TrackMesh.h"
+#include "CatmullRom.h"
+#include "Profiler.h"
+#include <float.h>
+
+CTrackMesh::CTrackMesh()
+{
+    m_numCentrelinePoints = 0;
+    m_numOffsetPoints = 0;
+    m_trackTriangles = 0;
+}
+
+CTrackMesh::~CTrackMesh()
+{
+}
+
+void CTrackMesh::Create(CCatmullRom* pTrack, string directory, string filename)
+{
+    PROFILE_ZONE("CTrackMesh::Create");
+
+    m_numCentrelinePoints = (GLsizei)pTrack->GetCentrelinePoints().size();
+    m_numOffsetPoints = (GLsizei)pTrack->GetLeftOffsetPoints().size();
+
+    CreateLineLoop(pTrack->GetCentrelinePoints(), m_vboCentreline);
+    CreateLineLoop(pTrack->GetLeftOffsetPoints(), m_vboLeftOffsetCurve);
+    CreateLineLoop(pTrack->GetRightOffsetPoints(), m_vboRightOffsetCurve);
+    CreateTrack(pTrack, directory, filename);
+}
+
+// Get a loop of points onto the graphics card
+void CTrackMesh::CreateLineLoop(const vector<glm::vec3>& points, CVertexBufferObject& vbo)
+{
+    vbo.Create();
+    vbo.Reserve((int)points.size());
+
+    //Default texture coordinates and normals for all points
+    glm::vec2 texCoord(0.0f, 0.0f);
+    glm::vec3 normal(0.0f, 1.0f, 0.0f);
+
+    //Add all points to VBO
+    for (unsigned int i = 0; i < points.size(); i++)
+        vbo.AddVertex(MeshVertex(points[i], texCoord, normal));
+
+    vbo.UploadDataToGPU();
+}
+
+void CTrackMesh::CreateTrack(CCatmullRom* pTrack, string directory, string filename)
+{
+    //Load track texture
+    m_texture.Load(directory + filename, true);
+    m_texture.SetSamplerObjectParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    m_texture.SetSamplerObjectParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+    m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    //Default normals pointing up
+    glm::vec3 normal(0.0f, 1.0f, 0.0f);
+
+    float trackWidth = 50.0f;
+    float trackLength = pTrack->GetTrackLength();
+    float texRepeatLength = trackLength / 50.0f; //Texture repeats a whole number of times around the loop
+
+    //The track is cut into chunks of (about) chunkLength. Each chunk is sampled densely, and each level of detail keeps
+    //a subset of those samples as rows of the ribbon.  Chunk boundaries are always kept, so every level agrees there
+    const float chunkLength = 200.0f;
+    const int samplesPerChunk = 128;
+    int numChunks = glm::max(1, (int)(trackLength / chunkLength + 0.5f));
+    int numSamples = numChunks * samplesPerChunk;
+    float sampleSpacing = trackLength / numSamples;
+
+    vector<float> distances(numSamples);
+    vector<glm::vec3> points(numSamples), tangents(numSamples);
+    for (int i = 0; i < numSamples; i++)
+        distances[i] = i * sampleSpacing;
+    pTrack->SampleMany(&distances[0], numSamples, &points[0], NULL, &tangents[0]);
+
+    //Left and right edges of the ribbon at each sample
+    vector<glm::vec3> leftPoints(numSamples), rightPoints(numSamples);
+    for (int i = 0; i < numSamples; i++) {
+        glm::vec3 N = glm::normalize(glm::vec3(-tangents[i].z, 0.0f, tangents[i].x));
+        leftPoints[i] = points[i] - (trackWidth / 2.0f) * N;
+        rightPoints[i] = points[i] + (trackWidth / 2.0f) * N;
+    }
+
+    m_trackChunks.assign(numChunks, TrackChunk());
+    vector<BoundingSphere> chunkSpheres;
+    for (int c = 0; c < numChunks; c++) {
+        int first = c * samplesPerChunk;
+        glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+        for (int i = first; i <= first + samplesPerChunk; i++) {
+            boxMin = glm::min(boxMin, glm::min(leftPoints[i % numSamples], rightPoints[i % numSamples]));
+            boxMax = glm::max(boxMax, glm::max(leftPoints[i % numSamples], rightPoints[i % numSamples]));
+        }
+        m_trackChunks[c].box = BoundingBox(boxMin, boxMax);
+        m_trackChunks[c].startDistance = distances[first];
+        chunkSpheres.push_back(BoundingSphere((boxMin + boxMax) * 0.5f, glm::length(boxMax - boxMin) * 0.5f));
+    }
+    m_trackTree.Build(chunkSpheres);
+
+    //Rows are kept where the track has turned by more than maxAngle degrees since the last row, and at least every
+    //maxStep samples. Coarser levels allow more turning and longer straights
+    const float maxAngle[NUM_TRACK_LODS] = { 1.0f, 4.0f, 12.0f };
+    const int maxStep[NUM_TRACK_LODS] = { 4, 16, 64 };
+
+    //The rows of every chunk at every level are chosen first, so the whole mesh can be reserved before it is built.  Each
+    //run of rows is one chunk at one level; levels are stored one after another, so neighbouring chunks at the same level
+    //are also neighbours in the index buffer
+    int numRuns = NUM_TRACK_LODS * numChunks;
+    vector<int> rows;
+    vector<size_t> firstRow(numRuns + 1);
+    for (int lod = 0; lod < NUM_TRACK_LODS; lod++) {
+        for (int c = 0; c < numChunks; c++) {
+            int first = c * samplesPerChunk;
+            firstRow[lod * numChunks + c] = rows.size();
+            SelectTrackRows(tangents, first, first + samplesPerChunk, maxAngle[lod], maxStep[lod], rows);
+        }
+    }
+    firstRow[numRuns] = rows.size();
+
+    //Two vertices per row, and two triangles between neighbouring rows of a run
+    m_vboTrack.Create();
+    m_vboTrack.Reserve(2 * (int)rows.size(), 6 * ((int)rows.size() - numRuns));
+
+    for (int lod = 0; lod < NUM_TRACK_LODS; lod++) {
+        for (int c = 0; c < numChunks; c++) {
+            size_t begin = firstRow[lod * numChunks + c];
+            size_t end = firstRow[lod * numChunks + c + 1];
+
+            //Add a left and right vertex per row. The last row of the last chunk wraps round to the first sample,
+            //with the texture coordinate carried on so the loop closes
+            GLuint base = (GLuint)m_vboTrack.GetNumVertices();
+            for (size_t r = begin; r < end; r++) {
+                int i = rows[r] % numSamples;
+                float texCoordS = rows[r] * sampleSpacing / texRepeatLength;
+
+                //Add left and right vertex
+                m_vboTrack.AddVertex(MeshVertex(leftPoints[i], glm::vec2(0.0f, texCoordS), normal));
+                m_vboTrack.AddVertex(MeshVertex(rightPoints[i], glm::vec2(1.0f, texCoordS), normal));
+            }
+
+            //Chunk index ranges are relative to the start of the track's indices in the arena
+            m_trackChunks[c].firstIndex[lod] = (GLuint)m_vboTrack.GetNumIndices();
+            for (GLuint r = 0; r + 1 < (GLuint)(end - begin); r++) {
+                GLuint v = base + 2 * r;
+                m_vboTrack.AddTriangle(v, v + 1, v + 2);
+                m_vboTrack.AddTriangle(v + 2, v + 1, v + 3);
+            }
+            m_trackChunks[c].indexCount[lod] = (GLsizei)m_vboTrack.GetNumIndices() - m_trackChunks[c].firstIndex[lod];
+        }
+    }
+
+    m_vboTrack.UploadDataToGPU();
+    m_trackDraws.Create();
+}
+
+// Choose which of the samples first..last become rows of the ribbon.  The two ends are always kept; in between, a sample is
+// kept once the tangent has turned by maxAngle degrees since the previous row, or maxStep samples have passed
+void CTrackMesh::SelectTrackRows(const vector<glm::vec3>& tangents, int first, int last, float maxAngle, int maxStep, vector<int>& rows)
+{
+    int numSamples = (int)tangents.size();
+    float minCos = cos(glm::radians(maxAngle));
+
+    rows.push_back(first);
+    int previous = first;
+    for (int i = first + 1; i < last; i++) {
+        if (i - previous >= maxStep || glm::dot(tangents[previous % numSamples], tangents[i % numSamples]) < minCos) {
+            rows.push_back(i);
+            previous = i;
+        }
+    }
+    rows.push_back(last);
+}
+
+// Level of detail for a chunk, from the distance between the viewer and the nearest point of its box
+int CTrackMesh::ChooseTrackLod(const TrackChunk& chunk, const glm::vec3& viewPosition)
+{
+    const float lodDistance[NUM_TRACK_LODS - 1] = { 300.0f, 800.0f };
+
+    glm::vec3 nearest = glm::clamp(viewPosition, chunk.box.min, chunk.box.max);
+    float distance = glm::length(nearest - viewPosition);
+
+    int lod = 0;
+    while (lod < NUM_TRACK_LODS - 1 && distance > lodDistance[lod])
+        lod++;
+    return lod;
+}
+
+void CTrackMesh::RenderCentreline()
+{
+    // Bind the VAO and render the centreline's range of it
+    glLineWidth(5.0f);
+    m_vboCentreline.Bind();
+    GLint first = m_vboCentreline.GetRange().baseVertex;
+    glDrawArrays(GL_POINT, first, m_numCentrelinePoints);
+    glDrawArrays(GL_LINE_LOOP, first, m_numCentrelinePoints);
+
+}
+
+void CTrackMesh::RenderOffsetCurves()
+{
+    // Both curves are in the same VAO, at different ranges
+    glLineWidth(3.0f);
+    m_vboLeftOffsetCurve.Bind();
+    GLint first = m_vboLeftOffsetCurve.GetRange().baseVertex;
+    glDrawArrays(GL_POINTS, first, m_numOffsetPoints);
+    glDrawArrays(GL_LINE_LOOP, first, m_numOffsetPoints);
+
+    first = m_vboRightOffsetCurve.GetRange().baseVertex;
+    glDrawArrays(GL_POINTS, first, m_numOffsetPoints);
+    glDrawArrays(GL_LINE_LOOP, first, m_numOffsetPoints);
+}
+
+void CTrackMesh::RenderTrack(const glm::vec3& viewPosition, const CFrustum* pFrustum, CullStats* pStats)
+{
+    SelectTrackChunks(viewPosition, pFrustum, pStats);
+    RenderSelectedChunks();
+}
+
+void CTrackMesh::SelectTrackChunks(const glm::vec3& viewPosition, const CFrustum* pFrustum, CullStats* pStats)
+{
+    PROFILE_ZONE("CTrackMesh::SelectTrackChunks");
+
+    //The sphere tree rejects most of the track quickly, then the chunk boxes, which fit the track much more tightly, are checked
+    m_visibleChunks.clear();
+    if (pFrustum != NULL)
+        m_trackTree.Query(*pFrustum, m_visibleChunks);
+    else {
+        for (int c = 0; c < (int)m_trackChunks.size(); c++)
+            m_visibleChunks.push_back(c);
+    }
+
+    //Runs of neighbouring visible chunks at the same level of detail are next to each other in the index buffer, so the
+    //draw list merges them into one range
+    m_trackDraws.Clear();
+    m_trackTriangles = 0;
+    int visible = 0;
+    for (size_t i = 0; i < m_visibleChunks.size(); i++) {
+        int c = m_visibleChunks[i];
+        const TrackChunk& chunk = m_trackChunks[c];
+        if (pFrustum != NULL && !pFrustum->IsBoxVisible(chunk.box))
+            continue;
+
+        int lod = ChooseTrackLod(chunk, viewPosition);
+        m_trackDraws.Add(m_vboTrack.GetRange(), chunk.firstIndex[lod], chunk.indexCount[lod]);
+        m_trackTriangles += chunk.indexCount[lod] / 3;
+        visible++;
+    }
+
+    if (pStats != NULL) {
+        pStats->visible += visible;
+        pStats->culled += (int)m_trackChunks.size() - visible;
+    }
+}
+
+void CTrackMesh::RenderSelectedChunks()
+{
+    // One multi-draw for every range chosen.  The commands are only uploaded again when the chosen ranges change
+    m_texture.Bind();
+    m_trackDraws.Render();
+}
+
+int CTrackMesh::GetNumTrackChunks()
+{
+    return (int)m_trackChunks.size();
+}
+
+const TrackChunk& CTrackMesh::GetTrackChunk(int chunk)
+{
+    return m_trackChunks[chunk];
+}
+
+int CTrackMesh::GetTrackTriangles()
+{
+    return m_trackTriangles;
+}
+
+int CTrackMesh::GetDrawUploads()
+{
+    return m_trackDraws.GetUploads();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "Common.h"
+#include "Texture.h"
+#include "Frustum.h"
+#include "VertexBufferObject.h"
+#include "VertexBufferObjectIndexed.h"
+#include "SceneDrawList.h"
+
+class CCatmullRom;
+
+#define NUM_TRACK_LODS 3	// Tessellation levels per track chunk, 0 being the finest
+
+// A run of track of fixed arc length.  Each level of detail is a contiguous range of the track's indices.  All
+// levels start and end on the same pair of vertices, so neighbouring chunks at different levels meet without cracks
+struct TrackChunk
+{
+	BoundingBox box;
+	float startDistance;					// Distance along the centreline where the chunk starts
+	GLuint firstIndex[NUM_TRACK_LODS];		// First index, from the start of the track's indices, per level
+	GLsizei indexCount[NUM_TRACK_LODS];
+};
+
+// The GPU side of the track: vertices for the centreline, offset curves and road surface, built from a CCatmullRom.  The spline itself needs no GL context, so the race can be simulated without one
+class CTrackMesh
+{
+public:
+	CTrackMesh();
+	~CTrackMesh();
+
+	void Create(CCatmullRom* pTrack, string sDirectory, string sFilename);	// The track's centreline and offset curves must already be created
+
+	void RenderCentreline();
+	void RenderOffsetCurves();
+	void RenderTrack(const glm::vec3& viewPosition, const CFrustum* pFrustum = NULL, CullStats* pStats = NULL);	// Draws only the chunks inside the frustum, if given, at a level of detail chosen by distance
+
+	// RenderTrack in two halves, so the chunks can be chosen when a draw is queued and drawn when the queue runs
+	void SelectTrackChunks(const glm::vec3& viewPosition, const CFrustum* pFrustum = NULL, CullStats* pStats = NULL);
+	void RenderSelectedChunks();
+
+	int GetNumTrackChunks();
+	int GetTrackTriangles();				// Triangles in the last chunks selected
+	int GetDrawUploads();					// Times the chosen ranges changed and were sent to the GPU
+	const TrackChunk& GetTrackChunk(int chunk);
+
+private:
+	void CreateLineLoop(const vector<glm::vec3>& points, CVertexBufferObject& vbo);
+	void CreateTrack(CCatmullRom* pTrack, string sDirectory, string sFilename);
+	void SelectTrackRows(const vector<glm::vec3>& tangents, int first, int last, float maxAngle, int maxStep, vector<int>& rows);
+	int ChooseTrackLod(const TrackChunk& chunk, const glm::vec3& viewPosition);
+
+	CTexture m_texture;
+
+	CVertexBufferObject m_vboCentreline;
+	CVertexBufferObject m_vboLeftOffsetCurve;
+	CVertexBufferObject m_vboRightOffsetCurve;
+	CVertexBufferObjectIndexed m_vboTrack;	// The road surface, every level of detail
+	GLsizei m_numCentrelinePoints;
+	GLsizei m_numOffsetPoints;
+
+	vector<TrackChunk> m_trackChunks;		// Track chunks in order along the track
+	CBoundingSphereTree m_trackTree;		// Spheres around the chunk boxes, for hierarchical culling
+	vector<int> m_visibleChunks;			// Scratch space for SelectTrackChunks
+	CSceneDrawList m_trackDraws;			// Index ranges chosen by SelectTrackChunks
+	int m_trackTriangles;					// Triangles in those ranges
+};
@@ -0,0 +1,156 @@
+#include "TrackPlacements.h"
+#include "CatmullRom.h"
+#include "CollectibleSet.h"
+#include "TrackBroadphase.h"
+
+CTrackPlacements::CTrackPlacements()
+{
+}
+
+CTrackPlacements::~CTrackPlacements()
+{
+}
+
+void CTrackPlacements::Create(CCatmullRom* pTrack)
+{
+	float trackLength = pTrack->GetTrackLength();
+	float trackWidth = 50.0f;
+	float maxLateralOffset = 0.7f;
+
+	// Coins
+	float coinSpacing = 15.0f;
+	int numCoins = static_cast<int>(trackLength / coinSpacing);
+
+	m_coins.clear();
+	m_coins.reserve(numCoins);
+
+	SplineCursor cursor; //Coins are visited in order along the track, so each search starts from the last one
+	for (int i = 0; i < numCoins; i++) {
+		float distance = i * coinSpacing;
+		SplineFrame frame;
+
+		if (!pTrack->SampleFrame(distance, cursor, frame))
+			continue;
+
+		//Apply a zigzag spread to the coins using sin
+		float zigzagFactor = sin(i * 0.5f);
+		float lateralOffset = maxLateralOffset * zigzagFactor;
+
+		TrackPlacement coin;
+		coin.position = frame.p + frame.N * (trackWidth * 0.5f * lateralOffset);
+
+		// Raise coins slightly higher to be more visible
+		coin.position.y += 2.5f;
+
+		coin.distance = distance;
+		coin.direction = frame.T;
+		coin.colour = glm::vec3(1.0f);
+		m_coins.push_back(coin);
+	}
+
+	// Tyres
+	float tyreSpacing = 100.0f;
+	int numTyres = static_cast<int>(trackLength / tyreSpacing);
+
+	m_tyres.clear();
+	m_tyres.reserve(numTyres);
+
+	cursor = SplineCursor();
+	for (int i = 0; i < numTyres; i++) {
+		float distance = i * tyreSpacing + (tyreSpacing / 2.0f); // Offset from coins
+		SplineFrame frame;
+
+		if (!pTrack->SampleFrame(distance, cursor, frame))
+			continue;
+
+		float zigzagFactor = sin(i * 0.5f);
+		float lateralOffset = maxLateralOffset * -zigzagFactor; //Negative so its placed opposite to coins
+
+		TrackPlacement tyre;
+		tyre.position = frame.p + frame.N * (trackWidth * 0.5f * lateralOffset);
+		tyre.position.y += 1.0f; // Position on the track
+
+		tyre.distance = distance;
+		tyre.direction = frame.T;
+		tyre.colour = glm::vec3(1.0f);
+		m_tyres.push_back(tyre);
+	}
+
+	// Lights
+	float lightSpacing = 30.0f; // Spacing between lights. Lights are clustered, so there is no limit on how many
+	int numLights = static_cast<int>(trackLength / lightSpacing);
+
+	float lightOffset = 1.2f; // Spacing from track edge
+
+	m_lights.clear();
+	m_lights.reserve(numLights);
+
+	cursor = SplineCursor();
+	for (int i = 0; i < numLights; i++) {
+		// Calculate position along track 
+		float distance = i * lightSpacing;
+		SplineFrame frame;
+
+		if (!pTrack->SampleFrame(distance, cursor, frame))
+			continue;
+
+		// Alternate between left and right of the track
+		float side = (i % 2 == 0) ? 1.0f : -1.0f;
+
+		// Position light post at the side of the track
+		glm::vec3 postPosition = frame.p + frame.N * (trackWidth * 0.5f * lightOffset * side);
+		postPosition.y += 0.5f;
+
+		// Position spotlight at the base of the light mesh
+		TrackPlacement light;
+		light.position = postPosition;
+
+		// Target light onto track
+		glm::vec3 targetPointOnTrack = frame.p + frame.N * (trackWidth * 0.2f * side * -1.0f);
+		targetPointOnTrack.y += 0.1f; // Just above track surface
+
+		// Calculate direction from light to target point
+		light.direction = glm::normalize(targetPointOnTrack - light.position);
+
+		// Apply colours to lights
+		float baseIntensity = 50.0f;
+		switch (i % 4) {
+		case 0: light.colour = glm::vec3(1.0f, 0.2f, 0.1f) * baseIntensity; break; // Red
+		case 1: light.colour = glm::vec3(0.2f, 0.2f, 1.0f) * baseIntensity; break; // Blue
+		case 2: light.colour = glm::vec3(1.0f, 0.7f, 0.1f) * baseIntensity; break; // Yellow
+		case 3: light.colour = glm::vec3(0.2f, 1.0f, 0.3f) * baseIntensity; break; // Green
+		}
+
+		light.distance = distance;
+		m_lights.push_back(light);
+	}
+}
+
+const vector<TrackPlacement>& CTrackPlacements::GetCoins() const
+{
+	return m_coins;
+}
+
+const vector<TrackPlacement>& CTrackPlacements::GetTyres() const
+{
+	return m_tyres;
+}
+
+const vector<TrackPlacement>& CTrackPlacements::GetLights() const
+{
+	return m_lights;
+}
+
+void CTrackPlacements::LoadCollectibles(const vector<TrackPlacement>& placements, float trackLength, CCollectibleSet* pSet, CTrackBroadphase* pBroadphase)
+{
+	vector<float> distances;
+	distances.reserve(placements.size());
+
+	pSet->Clear();
+	pSet->Reserve((int)placements.size());
+	for (size_t i = 0; i < placements.size(); i++) {
+		pSet->Add(placements[i].position);
+		distances.push_back(placements[i].distance);
+	}
+	pBroadphase->Build(distances, trackLength, 25.0f);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CommonCore.h"
+
+class CCatmullRom;
+class CCollectibleSet;
+class CTrackBroadphase;
+
+// Where one object beside the track goes
+struct TrackPlacement
+{
+	glm::vec3 position;
+	float distance;			// Distance along the centreline
+	glm::vec3 direction;	// Unit vector the object faces: along the track for tyres, at the track for lights
+	glm::vec3 colour;		// Lights only
+};
+
+// Coins, tyres and lights laid out along the track.  Their positions depend only on the track, so they are worked out once
+// when it is built.  Nothing here touches GL: the game turns the placements into instance transforms, and the headless
+// driver only needs the collectibles
+class CTrackPlacements
+{
+public:
+	CTrackPlacements();
+	~CTrackPlacements();
+
+	void Create(CCatmullRom* pTrack);
+
+	const vector<TrackPlacement>& GetCoins() const;
+	const vector<TrackPlacement>& GetTyres() const;
+	const vector<TrackPlacement>& GetLights() const;
+
+	// Fills a collectible set and its broadphase from a list of placements, in the same order
+	static void LoadCollectibles(const vector<TrackPlacement>& placements, float trackLength, CCollectibleSet* pSet, CTrackBroadphase* pBroadphase);
+
+private:
+	vector<TrackPlacement> m_coins;
+	vector<TrackPlacement> m_tyres;
+	vector<TrackPlacement> m_lights;
+};
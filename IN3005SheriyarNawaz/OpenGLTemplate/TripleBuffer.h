@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+
+// Hands whole objects from one producer thread to one consumer thread without locks.  The producer fills the write
+// slot and publishes it; the consumer picks up the most recently published slot whenever it is ready.  Neither side
+// ever waits for the other, and the consumer never sees a half-written object.
+//
+// There are three slots: one owned by each side, and a shared middle slot that the two swap into and out of.  The
+// middle slot index carries a flag saying it holds something the consumer has not seen yet.
+template <class T>
+class CTripleBuffer
+{
+public:
+	CTripleBuffer() : m_writeIndex(0), m_middle(1), m_readIndex(2) {}
+
+	// Producer side
+	T& GetWriteBuffer() { return m_buffers[m_writeIndex]; }
+	void Publish()
+	{
+		m_writeIndex = m_middle.exchange(m_writeIndex | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Consumer side.  Acquire returns false (and keeps the current read buffer) if nothing new has been published
+	bool Acquire()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & NEW_DATA) == 0)
+			return false;
+		m_readIndex = m_middle.exchange(m_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+	const T& GetReadBuffer() const { return m_buffers[m_readIndex]; }
+
+private:
+	enum { INDEX_MASK = 3, NEW_DATA = 4 };
+
+	CTripleBuffer(const CTripleBuffer&);
+	CTripleBuffer& operator=(const CTripleBuffer&);
+
+	T m_buffers[3];
+	int m_writeIndex;				// Only touched by the producer
+	std::atomic<int> m_middle;		// Index of the shared slot, plus NEW_DATA
+	int m_readIndex;				// Only touched by the consumer
+};
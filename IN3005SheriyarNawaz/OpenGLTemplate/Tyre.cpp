@@ -22,10 +22,9 @@ void CTyre::Create(string a_sDirectory, string a_sFilename, int mainSegments, in
 	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
 	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
+	//A grid of (mainSegments + 1) x (tubeSegments + 1) vertices, two triangles per cell
 	m_vbo.Create();
-	m_vbo.Bind();
+	m_vbo.Reserve((mainSegments + 1) * (tubeSegments + 1), 6 * mainSegments * tubeSegments);
 
 	int vertexCount = 0;
 
@@ -64,9 +63,7 @@ void CTyre::Create(string a_sDirectory, string a_sFilename, int mainSegments, in
 			glm::vec2 texCoord = glm::vec2(u, v);
 
 			// Add the vertex data to the VBO
-			m_vbo.AddVertexData(&position, sizeof(glm::vec3));
-			m_vbo.AddVertexData(&texCoord, sizeof(glm::vec2));
-			m_vbo.AddVertexData(&normal, sizeof(glm::vec3));
+			m_vbo.AddVertex(MeshVertex(position, texCoord, normal));
 
 			vertexCount++;
 		}
@@ -86,41 +83,43 @@ void CTyre::Create(string a_sDirectory, string a_sFilename, int mainSegments, in
 			//Using counter clockwise winding to calculate indices
 
 			// First triangle 
-			m_vbo.AddIndexData(&v2, sizeof(unsigned int));
-			m_vbo.AddIndexData(&v1, sizeof(unsigned int));
-			m_vbo.AddIndexData(&v0, sizeof(unsigned int));
+			m_vbo.AddTriangle(v2, v1, v0);
 			m_numTriangles++;
 
 			// Second triangle 
-			m_vbo.AddIndexData(&v2, sizeof(unsigned int));
-			m_vbo.AddIndexData(&v3, sizeof(unsigned int));
-			m_vbo.AddIndexData(&v1, sizeof(unsigned int));
+			m_vbo.AddTriangle(v2, v3, v1);
 			m_numTriangles++;
 		}
 	}
 
-	m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
-	GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
-
-	// Set up vertex attribute pointers
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);  // Position
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));  // Texture coords
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));  // Normal
+	m_vbo.UploadDataToGPU();
 }
 
 void CTyre::Render()
 {
-	glBindVertexArray(m_vao);
+	const GeometryRange& range = m_vbo.GetRange();
+	m_vbo.Bind();
+	m_texture.Bind();
+	glDrawElementsBaseVertex(GL_TRIANGLES, m_numTriangles * 3, GL_UNSIGNED_INT, range.GetIndexOffset(), range.baseVertex);
+}
+
+// Render every visible instance in one draw call
+void CTyre::RenderInstanced(CInstanceBuffer* pInstances)
+{
+	if (pInstances->GetNumInstances() == 0)
+		return;
+
+	const GeometryRange& range = m_vbo.GetRange();
+	m_vbo.Bind();
+	pInstances->Bind();
 	m_texture.Bind();
-	glDrawElements(GL_TRIANGLES, m_numTriangles * 3, GL_UNSIGNED_INT, 0);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_numTriangles * 3, GL_UNSIGNED_INT, range.GetIndexOffset(),
+		pInstances->GetNumInstances(), range.baseVertex);
+	pInstances->Unbind();
 }
 
 void CTyre::Release()
 {
 	m_texture.Release();
-	glDeleteVertexArrays(1, &m_vao);
 	m_vbo.Release();
 }
\ No newline at end of file
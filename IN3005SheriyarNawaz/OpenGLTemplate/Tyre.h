@@ -2,6 +2,7 @@
 #include "Common.h"
 #include "Texture.h"
 #include "VertexBufferObjectIndexed.h"
+#include "InstanceBuffer.h"
 
 class CTyre
 {
@@ -11,10 +12,10 @@ public:
 
 	void Create(string a_sDirectory, string a_sFilename, int mainSegments, int tubeSegments, float mainRadius, float tubeRadius);
 	void Render();
+	void RenderInstanced(CInstanceBuffer* pInstances);
 	void Release();
 
 private:
-	GLuint m_vao;
 	CVertexBufferObjectIndexed m_vbo;
 	CTexture m_texture;
 	string m_directory;
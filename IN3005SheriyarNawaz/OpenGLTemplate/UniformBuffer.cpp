@@ -0,0 +1,42 @@
+#include "UniformBuffer.h"
+
+CUniformBuffer::CUniformBuffer()
+{
+	m_ubo = 0;
+	m_size = 0;
+	m_bindingPoint = 0;
+}
+
+CUniformBuffer::~CUniformBuffer()
+{
+}
+
+// Create a UBO of the given size and attach it to a binding point.  Programs are connected to the same
+// binding point with CShaderProgram::BindUniformBlock.
+void CUniformBuffer::Create(UINT size, UINT bindingPoint)
+{
+	m_size = size;
+	m_bindingPoint = bindingPoint;
+
+	glGenBuffers(1, &m_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, m_size, NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, m_bindingPoint, m_ubo);
+}
+
+// Replace the whole block.  Orphaning the old storage first means the driver doesn't have to wait for
+// draws from the previous frame that still read it.
+void CUniformBuffer::Update(const void* ptrData, UINT dataSize)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, m_size, NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize < m_size ? dataSize : m_size, ptrData);
+}
+
+// Release the UBO
+void CUniformBuffer::Release()
+{
+	if (m_ubo != 0)
+		glDeleteBuffers(1, &m_ubo);
+	m_ubo = 0;
+}
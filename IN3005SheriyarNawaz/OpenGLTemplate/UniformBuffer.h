@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Common.h"
+
+// Binding points shared by every shader program that declares these blocks
+#define CAMERA_BLOCK_BINDING 0
+#define LIGHT_BLOCK_BINDING 1
+
+// The structures below mirror the std140 uniform blocks in mainShader.vert and mainShader.frag, so they can be
+// uploaded with a single buffer update.  vec3 members take up 16 bytes in std140, hence the padding.
+
+struct CameraBlock
+{
+	glm::mat4 projMatrix;
+	glm::mat4 viewMatrix;
+};
+
+struct LightInfoBlock
+{
+	glm::vec4 position;					// Eye coordinates
+	glm::vec3 La; float pad0;
+	glm::vec3 Ld; float pad1;
+	glm::vec3 Ls; float pad2;
+	glm::vec3 direction;				// Eye coordinates
+	float exponent;
+	float cutoff; float pad3[3];
+};
+
+// The track lights themselves are binned into clusters by CLightClusters; this block only carries what every
+// fragment needs to find its cluster
+struct LightBlock
+{
+	LightInfoBlock light1;
+	glm::vec4 trackAmbient;				// rgb = combined ambient term of the track lights
+	glm::ivec4 clusterDims;				// x, y = screen tiles, z = depth slices, w = tile size in pixels
+	glm::vec4 clusterDepth;				// x = near plane, y = slices per unit of log depth
+};
+
+static_assert(sizeof(LightInfoBlock) == 96, "LightInfoBlock must match the std140 layout of LightInfo");
+static_assert(sizeof(LightBlock) == 96 + 3 * 16, "LightBlock must match the std140 layout of the shader block");
+
+// This class provides a wrapper around an OpenGL uniform buffer object attached to a fixed binding point
+class CUniformBuffer
+{
+public:
+	CUniformBuffer();
+	~CUniformBuffer();
+
+	void Create(UINT size, UINT bindingPoint);		// Creates the UBO and attaches it to the binding point
+	void Update(const void* ptrData, UINT dataSize);	// Replaces the contents of the UBO
+	void Release();									// Releases the UBO
+
+private:
+	UINT m_ubo;										// UBO id
+	UINT m_size;
+	UINT m_bindingPoint;
+};
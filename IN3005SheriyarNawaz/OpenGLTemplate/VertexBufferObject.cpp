@@ -1,9 +1,11 @@
 #include "VertexBufferObject.h"
+#include <assert.h>
 
 
 // Constructor -- initialise member variable m_bDataUploaded to false
 CVertexBufferObject::CVertexBufferObject()
 {
+	m_format = VERTEX_FORMAT_MESH;
 	m_dataUploaded = false;
 }
 
@@ -11,42 +13,68 @@ CVertexBufferObject::~CVertexBufferObject()
 {
 }
 
-// Create a VBO 
-void CVertexBufferObject::Create()
+// Start a new set of vertices, giving back any range from before.  Nothing is allocated until the data is uploaded
+void CVertexBufferObject::Create(VertexFormat format)
 {
-	glGenBuffers(1, &m_vbo);
+	CGeometryArena::Free(m_range);
+	m_dataUploaded = false;
+	m_data.clear();
+	m_format = format;
 }
 
-// Release the VBO and any associated data
+// Give the range back to the arena and drop any associated data
 void CVertexBufferObject::Release()
 {
-	glDeleteBuffers(1, &m_vbo);
+	CGeometryArena::Free(m_range);
 	m_dataUploaded = false;
 	m_data.clear();
 }
 
 
-// Binds a VBO.  
+// Binds the VAO shared by every mesh in this format
 void CVertexBufferObject::Bind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	CGeometryArena::Bind(m_format);
 }
 
 
-// Uploads the data to the GPU.  Afterwards, the data can be cleared.  
-// iUsageHint - GL_STATIC_DRAW, GL_DYNAMIC_DRAW...
-void CVertexBufferObject::UploadDataToGPU(int usageHint)
+// Copies the data into the arena, in place of anything uploaded before.  Afterwards, the data can be cleared.
+void CVertexBufferObject::UploadDataToGPU()
 {
-	glBufferData(GL_ARRAY_BUFFER, m_data.size(), &m_data[0], usageHint);
+	CGeometryArena::Free(m_range);
+	GLsizei vertexSize = CGeometryArena::GetVertexSize(m_format);
+	m_range = CGeometryArena::Allocate(m_format, m_data.empty() ? NULL : &m_data[0], (int)(m_data.size() / vertexSize), NULL, 0);
 	m_dataUploaded = true;
 	m_data.clear();
 }
 
-// Adds data to the VBO.  
-void CVertexBufferObject::AddData(void* ptrData, UINT dataSize)
+// Reserve before adding vertices one at a time, so the storage is allocated once rather than grown as they arrive
+void CVertexBufferObject::Reserve(int numVertices)
 {
-	m_data.insert(m_data.end(), (BYTE*)ptrData, (BYTE*)ptrData+dataSize);
+	m_data.reserve(m_data.size() + (size_t)numVertices * CGeometryArena::GetVertexSize(m_format));
 }
 
+// Appends a whole interleaved vertex in one copy
+void CVertexBufferObject::AddVertex(const MeshVertex& vertex)
+{
+	assert(m_format == VERTEX_FORMAT_MESH);
+	const BYTE* pVertex = (const BYTE*)&vertex;
+	m_data.insert(m_data.end(), pVertex, pVertex + sizeof(MeshVertex));
+}
 
+void CVertexBufferObject::AddVertex(const TextVertex& vertex)
+{
+	assert(m_format == VERTEX_FORMAT_TEXT);
+	const BYTE* pVertex = (const BYTE*)&vertex;
+	m_data.insert(m_data.end(), pVertex, pVertex + sizeof(TextVertex));
+}
 
+int CVertexBufferObject::GetNumVertices() const
+{
+	return (int)(m_data.size() / CGeometryArena::GetVertexSize(m_format));
+}
+
+const GeometryRange& CVertexBufferObject::GetRange() const
+{
+	return m_range;
+}
@@ -1,24 +1,32 @@
 #pragma once
 
 #include "Common.h"
+#include "GeometryArena.h"
 
-// This class provides a wrapper around an OpenGL Vertex Buffer Object
+// This class provides a wrapper around a range of vertices in the geometry arena.  Vertices are added on the CPU, whole
+// structs at a time, into storage reserved up front when the count is known; then UploadDataToGPU copies them into the
+// arena.  Draws bind the format's VAO with Bind and start at GetRange().baseVertex
 class CVertexBufferObject
 {
 public:
 	CVertexBufferObject();
 	~CVertexBufferObject();
 
-	void Create();									// Creates a VBO
-	void Bind();									// Binds the VBO
-	void Release();									// Releases the VBO
+	void Create(VertexFormat format = VERTEX_FORMAT_MESH);	// Starts a new set of vertices in the given format
+	void Bind();									// Binds the VAO of the format
+	void Release();									// Frees the range in the arena
 
-	void AddData(void* ptrData, UINT dataSize);	// Adds data to the VBO
-	void UploadDataToGPU(int usageHint);			// Uploads the VBO to the GPU
+	void Reserve(int numVertices);					// Makes room for this many more vertices, so adding them never reallocates
+	void AddVertex(const MeshVertex& vertex);		// For VERTEX_FORMAT_MESH
+	void AddVertex(const TextVertex& vertex);		// For VERTEX_FORMAT_TEXT
+	int GetNumVertices() const;						// Vertices added since Create
+	void UploadDataToGPU();							// Copies the data into the arena
+
+	const GeometryRange& GetRange() const;			// Where the data went, once uploaded
 
-	
 private:
-	UINT m_vbo;									// VBO id
-	vector<BYTE> m_data;							// Data to be put in the VBO
+	VertexFormat m_format;
+	GeometryRange m_range;
+	vector<BYTE> m_data;							// Vertices to be put in the arena, in the layout of m_format
 	bool m_dataUploaded;							// A flag indicating if the data has been sent to the GPU
 };
\ No newline at end of file
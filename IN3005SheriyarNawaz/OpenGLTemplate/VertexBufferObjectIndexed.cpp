@@ -1,9 +1,11 @@
 #include "VertexBufferObjectIndexed.h"
+#include <assert.h>
 
 
 // Constructor -- initialise member variable m_bDataUploaded to false
 CVertexBufferObjectIndexed::CVertexBufferObjectIndexed()
 {
+	m_format = VERTEX_FORMAT_MESH;
 	m_dataUploaded = false;
 }
 
@@ -11,54 +13,78 @@ CVertexBufferObjectIndexed::~CVertexBufferObjectIndexed()
 {}
 
 
-// Create buffer objects for the vertices and indices
-void CVertexBufferObjectIndexed::Create()
+// Start a new mesh, giving back any range from before.  Nothing is allocated until the data is uploaded
+void CVertexBufferObjectIndexed::Create(VertexFormat format)
 {
-	glGenBuffers(1, &m_vboVertices);
-	glGenBuffers(1, &m_vboIndices);
+	CGeometryArena::Free(m_range);
+	m_dataUploaded = false;
+	m_vertexData.clear();
+	m_indexData.clear();
+	m_format = format;
 }
 
-// Release the buffers and any associated data
+// Give the range back to the arena and drop any associated data
 void CVertexBufferObjectIndexed::Release()
 {
-	glDeleteBuffers(1, &m_vboVertices);
-	glDeleteBuffers(1, &m_vboIndices);
+	CGeometryArena::Free(m_range);
 	m_dataUploaded = false;
 	m_vertexData.clear();
 	m_indexData.clear();
 }
 
 
-// Binds the buffers
+// Binds the VAO shared by every mesh in this format
 void CVertexBufferObjectIndexed::Bind()
 {
-	glBindBuffer(GL_ARRAY_BUFFER, m_vboVertices);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vboIndices);
+	CGeometryArena::Bind(m_format);
 }
 
 
-// Uploads the data to the GPU.  Afterwards, the data can be cleared.  
-// iUsageHint - GL_STATIC_DRAW, GL_DYNAMIC_DRAW...
-void CVertexBufferObjectIndexed::UploadDataToGPU(int iUsageHint)
+// Copies the data into the arena, in place of anything uploaded before.  Afterwards, the data can be cleared.
+void CVertexBufferObjectIndexed::UploadDataToGPU()
 {
-
-	glBufferData(GL_ARRAY_BUFFER, m_vertexData.size(), &m_vertexData[0], iUsageHint);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexData.size(), &m_indexData[0], iUsageHint);
+	CGeometryArena::Free(m_range);
+	GLsizei vertexSize = CGeometryArena::GetVertexSize(m_format);
+	m_range = CGeometryArena::Allocate(m_format, m_vertexData.empty() ? NULL : &m_vertexData[0], (int)(m_vertexData.size() / vertexSize),
+		m_indexData.empty() ? NULL : &m_indexData[0], (int)m_indexData.size());
 	m_dataUploaded = true;
 	m_vertexData.clear();
 	m_indexData.clear();
 }
 
-// Adds data to the VBO.  
-void CVertexBufferObjectIndexed::AddVertexData(void* ptrVertexData, UINT uiVertexDataSize)
+// Reserve before adding vertices and triangles one at a time, so the storage is allocated once rather than grown as they arrive
+void CVertexBufferObjectIndexed::Reserve(int numVertices, int numIndices)
+{
+	m_vertexData.reserve(m_vertexData.size() + (size_t)numVertices * CGeometryArena::GetVertexSize(m_format));
+	m_indexData.reserve(m_indexData.size() + numIndices);
+}
+
+// Appends a whole interleaved vertex in one copy
+void CVertexBufferObjectIndexed::AddVertex(const MeshVertex& vertex)
 {
-	m_vertexData.insert(m_vertexData.end(), (BYTE*)ptrVertexData, (BYTE*)ptrVertexData+uiVertexDataSize);
+	assert(m_format == VERTEX_FORMAT_MESH);
+	const BYTE* pVertex = (const BYTE*)&vertex;
+	m_vertexData.insert(m_vertexData.end(), pVertex, pVertex + sizeof(MeshVertex));
 }
 
+void CVertexBufferObjectIndexed::AddTriangle(GLuint index0, GLuint index1, GLuint index2)
+{
+	m_indexData.push_back(index0);
+	m_indexData.push_back(index1);
+	m_indexData.push_back(index2);
+}
 
-// Adds data to the VBO.  
-void CVertexBufferObjectIndexed::AddIndexData(void* ptrIndexData, UINT uiIndexDataSize)
+int CVertexBufferObjectIndexed::GetNumVertices() const
 {
-	m_indexData.insert(m_indexData.end(), (BYTE*)ptrIndexData, (BYTE*)ptrIndexData+uiIndexDataSize);
+	return (int)(m_vertexData.size() / CGeometryArena::GetVertexSize(m_format));
 }
 
+int CVertexBufferObjectIndexed::GetNumIndices() const
+{
+	return (int)m_indexData.size();
+}
+
+const GeometryRange& CVertexBufferObjectIndexed::GetRange() const
+{
+	return m_range;
+}
@@ -1,28 +1,36 @@
 #pragma once
 
 #include "Common.h"
+#include "GeometryArena.h"
 
+// A range of vertices and indices in the geometry arena.  Meshes are built with whole vertices and triangles, into
+// storage reserved up front when the counts are known, and then copied into the arena.  Draws bind the format's VAO with
+// Bind and pass GetRange()'s index offset and base vertex to glDrawElementsBaseVertex
 class CVertexBufferObjectIndexed
 {
 public:
 	CVertexBufferObjectIndexed();
 	~CVertexBufferObjectIndexed();
 
-	void Create();									// Creates a VBO
-	void Bind();									// Binds the VBO
-	void Release();									// Releases the VBO
+	void Create(VertexFormat format = VERTEX_FORMAT_MESH);	// Starts a new mesh in the given format
+	void Bind();									// Binds the VAO of the format
+	void Release();									// Frees the range in the arena
 
-	void AddVertexData(void* pVertexData, UINT vertexDataSize);	// Adds vertex data
-	void AddIndexData(void* pIndexData, UINT indexDataSize);	// Adds index data
-	void UploadDataToGPU(int iUsageHint);			// Upload the VBO to the GPU
+	void Reserve(int numVertices, int numIndices);	// Makes room for this many more, so adding them never reallocates
+	void AddVertex(const MeshVertex& vertex);
+	void AddTriangle(GLuint index0, GLuint index1, GLuint index2);	// Indices count from the mesh's first vertex
+	int GetNumVertices() const;						// Vertices added since Create, which is also the index of the next one
+	int GetNumIndices() const;
+	void UploadDataToGPU();							// Copies the data into the arena
 
+	const GeometryRange& GetRange() const;			// Where the data went, once uploaded
 
 private:
-	GLuint m_vboVertices;		// VBO id for vertices
-	GLuint m_vboIndices;		// VBO id for indices
+	VertexFormat m_format;
+	GeometryRange m_range;
 
-	vector<BYTE> m_vertexData;	// Vertex data to be uploaded
-	vector<BYTE> m_indexData;	// Index data to be uploaded
+	vector<BYTE> m_vertexData;	// Vertex data to be uploaded, in the layout of m_format
+	vector<GLuint> m_indexData;	// Index data to be uploaded
 
 	bool m_dataUploaded;		// Flag indicating if data is uploaded to the GPU
 };
\ No newline at end of file
@@ -34,11 +34,46 @@ struct MaterialInfo {
     float shininess;
 };
 
-// Uniform light and material
-uniform LightInfo light1;
+// Lights, written once per frame and shared between programs.  Positions and directions are in eye coordinates
+layout (std140) uniform LightBlock
+{
+    LightInfo light1;
+    vec4 trackAmbient;      // Combined ambient term of all track lights
+    ivec4 clusterDims;      // x, y = screen tiles, z = depth slices, w = tile size in pixels
+    vec4 clusterDepth;      // x = near plane, y = slices per unit of log depth
+};
+
+// Clustered track lights.  lightData holds five texels per light, clusterGrid an (offset, count) pair per
+// cluster and lightIndices the lists of lights that reach each cluster
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+
+// Uniform material
 uniform MaterialInfo material1;
-uniform int numActiveLights;
-uniform LightInfo trackLights[16];
+
+LightInfo FetchTrackLight(int index) {
+    LightInfo light;
+    vec4 position = texelFetch(lightData, index * 5);
+    vec4 direction = texelFetch(lightData, index * 5 + 1);
+    light.position = vec4(position.xyz, 1.0);
+    light.exponent = position.w;
+    light.direction = direction.xyz;
+    light.cutoff = direction.w;
+    light.La = texelFetch(lightData, index * 5 + 2).rgb;
+    light.Ld = texelFetch(lightData, index * 5 + 3).rgb;
+    light.Ls = texelFetch(lightData, index * 5 + 4).rgb;
+    return light;
+}
+
+// Find the cluster this fragment falls into from its screen tile and eye-space depth
+int ClusterIndex() {
+    ivec2 tile = ivec2(gl_FragCoord.xy) / clusterDims.w;
+    tile = clamp(tile, ivec2(0), clusterDims.xy - 1);
+    float depth = max(-eyePosition.z, clusterDepth.x);
+    int slice = clamp(int(log(depth / clusterDepth.x) * clusterDepth.y), 0, clusterDims.z - 1);
+    return (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+}
 
 // Convert lighting into toon shaders by applying bands of colours
 float toonify(float intensity) {
@@ -61,7 +96,6 @@ vec3 ApplySpotlight(LightInfo light, vec3 position, vec3 normal) {
     float distance = length(lightDir);
     vec3 s = normalize(lightDir); //Normalize light direction vector
 
-    vec3 ambient = light.La * material1.Ma * 0.7; //*0.7 to dim
     float cosAngle = dot(-s, normalize(light.direction)); //Get angle between light and its direction
 
     // Convert spot angle light into bands
@@ -88,7 +122,7 @@ vec3 ApplySpotlight(LightInfo light, vec3 position, vec3 normal) {
     float toonSpec = (pow(specDot, material1.shininess) > 0.6) ? 0.7 : 0.0; //Toonify specular angle factor
     vec3 specular = light.Ls * material1.Ms * toonSpec * 0.7; //Specular contribution to lighting
 
-    return ambient + (bandedAttenuation * bandedSpot * (diffuse + specular)); //Return total light contribution
+    return bandedAttenuation * bandedSpot * (diffuse + specular); //Return light contribution. Ambient is added once for all lights
 
 }
 
@@ -104,9 +138,14 @@ void main() {
         
         vec3 normal = normalize(eyeNormal);
         
-        // Add spotlight contributions from all track lights
-        for (int i = 0; i < numActiveLights && i < 16; i++) {
-            lightSum += ApplySpotlight(trackLights[i], eyePosition, normal);
+        // Ambient from the track lights reaches everything
+        lightSum += trackAmbient.rgb * material1.Ma * 0.7; //*0.7 to dim
+
+        // Add spotlight contributions from the track lights that reach this fragment's cluster
+        uvec2 cluster = texelFetch(clusterGrid, ClusterIndex()).xy;
+        for (uint i = 0u; i < cluster.y; i++) {
+            int lightIndex = int(texelFetch(lightIndices, int(cluster.x + i)).r);
+            lightSum += ApplySpotlight(FetchTrackLight(lightIndex), eyePosition, normal);
         }
         
         // Apply toon edge detection for outlines
@@ -1,16 +1,35 @@
 #version 400 core
 
+// Camera state, written once per frame and shared between programs
+layout (std140) uniform CameraBlock
+{
+	mat4 projMatrix;
+	mat4 viewMatrix;
+} camera;
+
 // Structure for matrices
 uniform struct Matrices
 {
-	mat4 projMatrix;
 	mat4 modelViewMatrix; 
 	mat3 normalMatrix;
 } matrices;
 
+// Animation applied to every instance of an instanced draw (spinning and wobbling coins)
+uniform struct InstanceAnimation
+{
+	float time;				// Seconds
+	float spinSpeed;		// Degrees per second around the y axis
+	float wobbleAmount;		// Degrees around the x axis
+	float wobbleSpeed;		// Radians per second
+} animation;
+
+// When set, each instance supplies its own model matrix and matrices.modelViewMatrix is ignored
+uniform bool bInstanced;
+
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec2 inCoord;
 layout (location = 2) in vec3 inNormal;
+layout (location = 3) in mat4 inInstanceMatrix;
 
 // Outputs to fragment shader
 out vec3 vColour;       
@@ -19,13 +38,40 @@ out vec3 worldPosition;
 out vec3 eyePosition;   
 out vec3 eyeNormal;     
 
+mat4 RotationY(float angle)
+{
+	float c = cos(angle);
+	float s = sin(angle);
+	return mat4(c, 0.0, -s, 0.0,  0.0, 1.0, 0.0, 0.0,  s, 0.0, c, 0.0,  0.0, 0.0, 0.0, 1.0);
+}
+
+mat4 RotationX(float angle)
+{
+	float c = cos(angle);
+	float s = sin(angle);
+	return mat4(1.0, 0.0, 0.0, 0.0,  0.0, c, s, 0.0,  0.0, -s, c, 0.0,  0.0, 0.0, 0.0, 1.0);
+}
+
 void main()
 {
+    mat4 modelViewMatrix = matrices.modelViewMatrix;
+    mat3 normalMatrix = matrices.normalMatrix;
+
+    if (bInstanced) {
+        float spinAngle = radians(mod(animation.spinSpeed * animation.time, 360.0));
+        float wobbleAngle = radians(animation.wobbleAmount * sin(animation.wobbleSpeed * animation.time));
+        modelViewMatrix = camera.viewMatrix * inInstanceMatrix * RotationY(spinAngle) * RotationX(wobbleAngle);
+
+        // Instance transforms are rotations, translations and uniform scales, so the upper 3x3 can be used
+        // for normals directly; eyeNormal is renormalised below
+        normalMatrix = mat3(modelViewMatrix);
+    }
+
     worldPosition = inPosition;
-    gl_Position = matrices.projMatrix * matrices.modelViewMatrix * vec4(inPosition, 1.0);
+    gl_Position = camera.projMatrix * modelViewMatrix * vec4(inPosition, 1.0);
     
-    eyePosition = vec3(matrices.modelViewMatrix * vec4(inPosition, 1.0));
-    eyeNormal = normalize(matrices.normalMatrix * inNormal);
+    eyePosition = vec3(modelViewMatrix * vec4(inPosition, 1.0));
+    eyeNormal = normalize(normalMatrix * inNormal);
     
     vTexCoord = inCoord;
     